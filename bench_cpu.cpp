@@ -0,0 +1,67 @@
+#include "modules/library.h"
+
+#include "modules/memory.h"
+#include "modules/cpu.h"
+
+//Klaus Dormann's 6502 functional test, see roms/6502_functional_test.lst
+#define FUNCTIONAL_TEST_ROM "roms/6502_functional_test.bin"
+#define FUNCTIONAL_TEST_START 0x0400
+#define FUNCTIONAL_TEST_SUCCESS 0x3463
+
+//Emulated cycles between two checks for a failure trap
+#define BENCH_BATCH 100000
+#define BENCH_MAX_CYCLES 1000000000ULL
+
+int main(int argc, const char **argv){
+
+	const string filename = (argc > 1) ? argv[1] : FUNCTIONAL_TEST_ROM;
+
+	//No VIC, CIAs or SDL: the test needs plain RAM from $0000 to $FFFF
+	Memory *mem = new Memory();
+	mem->bankSwitch(CHAREN_MASK);
+
+	if(!mem->load_custom_memory(filename,FUNCTIONAL_TEST_START)){
+		cout<<"Cannot open "<<filename<<endl;
+		return 2;
+	}
+
+	CPU *cpu = new CPU(mem,FUNCTIONAL_TEST_START);
+	cpu->setBreakpoint(FUNCTIONAL_TEST_SUCCESS);
+
+	bool trapped = false;
+
+	auto start_time = chrono::steady_clock::now();
+
+	while(cpu->PC != FUNCTIONAL_TEST_SUCCESS and cpu->cycles_executed < BENCH_MAX_CYCLES){
+
+		cpu->run(BENCH_BATCH);
+
+		//Failed tests end in a jump to itself
+		uint16_t pc = cpu->PC;
+		cpu->run(0);
+
+		if(cpu->PC == pc and pc != FUNCTIONAL_TEST_SUCCESS){
+			trapped = true;
+			break;
+		}
+	}
+
+	auto end_time = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(end_time - start_time).count();
+
+	bool passed = (cpu->PC == FUNCTIONAL_TEST_SUCCESS);
+
+	cout<<"Result:       "<<(passed ? "passed" : (trapped ? "failed" : "timeout"))<<endl;
+	cout<<"PC:           0x"<<hex<<unsigned(cpu->PC)<<dec<<endl;
+	cout<<"Wall time:    "<<seconds<<" s"<<endl;
+	cout<<"Cycles:       "<<cpu->cycles_executed<<endl;
+	cout<<"Instructions: "<<cpu->instructions_executed<<endl;
+	cout<<"MIPS:         "<<cpu->instructions_executed / seconds / 1e6<<endl;
+	cout<<"Emulated MHz: "<<cpu->cycles_executed / seconds / 1e6<<endl;
+
+	delete cpu;
+	delete mem;
+
+	return passed ? 0 : 1;
+
+}
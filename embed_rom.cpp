@@ -0,0 +1,53 @@
+#include "modules/library.h"
+
+#include <vector>
+#include <iterator>
+
+//Writes binary files as a C++ source, each one an array and its size, so the
+//stock ROMs are part of the executable instead of being read at every start
+int main(int argc, const char **argv){
+
+	if(argc < 4 or argc % 2 != 0){
+		cout<<"Usage: "<<argv[0]<<" roms.cpp name file [name file...]"<<endl;
+		return 2;
+	}
+
+	ofstream out(argv[1]);
+
+	if(!out.is_open())
+		return 1;
+
+	out<<"//Generated by embed_rom, do not edit"<<endl;
+	out<<"#include <cstddef>"<<endl;
+	out<<"#include <cstdint>"<<endl;
+
+	for(int arg = 2; arg < argc; arg += 2){
+
+		const string name = argv[arg];
+
+		ifstream file(argv[arg + 1], ios::in | ios::binary);
+
+		if(!file.is_open()){
+			cout<<"Cannot open "<<argv[arg + 1]<<endl;
+			return 1;
+		}
+
+		vector<char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+		if(data.empty()){
+			cout<<argv[arg + 1]<<" is empty"<<endl;
+			return 1;
+		}
+
+		out<<endl<<"extern const uint8_t "<<name<<"[] = {";
+
+		for(size_t i = 0; i < data.size(); i++)
+			out<<((i % 16) ? "" : "\n\t")<<unsigned((uint8_t)data[i])<<",";
+
+		out<<endl<<"};"<<endl<<endl;
+		out<<"extern const size_t "<<name<<"_size = sizeof("<<name<<");"<<endl;
+	}
+
+	return out.good() ? 0 : 1;
+
+}
@@ -1,131 +1,161 @@
 #include "modules/library.h"
 
-#include "modules/memory.h"
-#include "modules/cpu.h"
-#include "modules/SDLManager.h"
-#include "modules/cia1.h"
-#include "modules/cia2.h"
-#include "modules/loader.h"
+#include "modules/machine.h"
 
+#include <vector>
 
-void test_cpu(CPU*);
+//SDL may need to wrap main on some hosts
+#include <SDL2/SDL.h>
 
-Memory *mem;
-CPU *cpu;
-SDLManager *sdl;
 
-bool iterate = true;
+//Only for the signal handlers, the machine itself keeps no global state
+Machine *machine = nullptr;
+Profiler *profiler = nullptr;
+Tracer *tracer = nullptr;
 
 
 void dump_mem_handler(int s){
 	cout<<endl<<"Dump Video Mem.."<<endl;
-	//mem->dump_memory(0x400,1000);							//1000 byte not 1024!
-	mem->dump_color_memory();							//1000 byte not 1024!
+	//machine->getMemory()->dump_memory(0x400,1000);			//1000 byte not 1024!
+	machine->getMemory()->dump_color_memory();					//1000 byte not 1024!
 
 }
 
 void dump_cpu_handler(int s){
 	cout<<endl<<"Dump CPU"<<endl;
 
-	cout<<hex<<"PC: "<<unsigned(cpu->PC)<<endl;
+	cout<<hex<<"PC: "<<unsigned(machine->getCPU()->PC)<<endl;
+
+	if(profiler)
+		profiler->report(machine->getMemory(),PROFILE_TOP_N);
+
+	if(tracer and tracer->dump(TRACE_FILE))
+		cout<<"Trace written to "<<TRACE_FILE<<endl;
 
 	//sdl->checkFPS();
 }
 
+//Saves the trace and lets the default action end the process
+void crash_handler(int s){
+
+	tracer->dump(TRACE_FILE);
+
+	signal(s,SIG_DFL);
+	raise(s);
+
+}
+
 void chiudi(int s){
 
-	iterate = false;
+	machine->stop();
 	//SDL_Quit();
 	//exit(s);
 }
 
 int main(int argc, const char **argv){
-	//CTRL-Z
-//	signal(SIGTSTP,dump_mem_handler);
-
-	signal(SIGTSTP,dump_cpu_handler);
-	signal(SIGINT,chiudi);
 
-	VIC *vic = new VIC();
-	CIA1 *cia1 = new CIA1();
-	CIA2 *cia2 = new CIA2();
+	string filename = "";
+	string snapshot_file = "";
+	string save_file = "";
+	string rom_file = "";
+	string charset_file = "";
+	string load_directory = "";
+	bool cold_boot = false;
+	bool rewind = false;
+	bool warp = false;
+	vector<string> trap_names;
+
+	for(int i = 1; i < argc; i++){
+
+		const string arg = argv[i];
+
+		if(arg == "--profile")
+			profiler = new Profiler();
+		else if(arg == "--trace")
+			tracer = new Tracer();
+		else if(arg.compare(0, 7, "--trap=") == 0)
+			trap_names.push_back(arg.substr(7));
+		else if(arg == "--cold")
+			cold_boot = true;
+		else if(arg == "--rewind")
+			rewind = true;
+		else if(arg == "--warp")
+			warp = true;
+		else if(arg.compare(0, 11, "--snapshot=") == 0)
+			snapshot_file = arg.substr(11);
+		else if(arg.compare(0, 16, "--save-snapshot=") == 0)
+			save_file = arg.substr(16);
+		else if(arg.compare(0, 6, "--rom=") == 0)
+			rom_file = arg.substr(6);
+		else if(arg.compare(0, 10, "--charset=") == 0)
+			charset_file = arg.substr(10);
+		else if(arg.compare(0, 11, "--load-dir=") == 0)
+			load_directory = arg.substr(11);
+		else
+			filename = arg;
+	}
 
-	mem = new Memory();
-	mem->load_kernal_and_basic(KERNAL_BASIC_ROM);
-	mem->load_charset(CHARSET_ROM);
+	SDLManager *sdl = new SDLManager();
 
-	cpu = new CPU(mem);
+	machine = new Machine(sdl,filename);
 
+	if(rom_file != ""){
+		if(machine->loadKernalAndBasic(rom_file))
+			cold_boot = true;	//The built in snapshot was taken with the stock ROMs
+		else
+			cout<<"Cannot load "<<rom_file<<", using the built in ROMs"<<endl;
+	}
 
-	sdl = new SDLManager();
+	if(charset_file != "" and !machine->loadCharset(charset_file))
+		cout<<"Cannot load "<<charset_file<<", using the built in charset"<<endl;
 
-	cia1->setCPU(cpu);
-	cia1->setSDL(sdl);
+	//Straight to READY. instead of the reset routine and the RAM test
+	if(snapshot_file != ""){
+		if(!machine->restore(snapshot_file))
+			cout<<"Cannot restore "<<snapshot_file<<", cold boot"<<endl;
+	} else if(!cold_boot){
+		Snapshot ready(ready_snapshot, ready_snapshot_size);
 
-	cia2->setCPU(cpu);
-	cia2->setSDL(sdl);
+		if(!machine->restore(ready))
+			cout<<"Built in snapshot does not match, cold boot"<<endl;
+	}
 
-	mem->setVIC(vic);
-	mem->setCIA1(cia1);
-	mem->setCIA2(cia2);
+	if(load_directory != "")
+		machine->setLoadDirectory(load_directory);
 
-	vic->setMemory(mem);
-	vic->setSDL(sdl);
-	vic->setCPU(cpu);
-	vic->setCIA1(cia1);
-	vic->setCIA2(cia2);
+	for(const string &name : trap_names)
+		if(!machine->enableTrap(name))
+			cout<<"Unknown trap "<<name<<endl;
 
-	Loader *loader = nullptr;
+	if(profiler)
+		machine->setProfiler(profiler);
 
-	if(argc > 1){
-		const string s = argv[1];
-		loader = new Loader(cpu,mem,s);
-	} 
+	if(rewind)
+		machine->setRewind(new Rewind(machine));
 
-	while(iterate){
-		cpu->clock();
-		cia1->clock();
-		vic->clock();
+	if(warp)
+		machine->setWarp(true);
 
-		if(loader)
-			loader->clock();
+	if(tracer){
+		machine->setTracer(tracer);
 
+		signal(SIGSEGV,crash_handler);
+		signal(SIGABRT,crash_handler);
+		signal(SIGFPE,crash_handler);
 	}
 
-}
+	//CTRL-Z
+//	signal(SIGTSTP,dump_mem_handler);
 
-void test_cpu(CPU *cpu)
-{
-	uint16_t pc=0;
-	uint8_t opcode;
-	bool loop = true;
-
-	while(loop)
-	{
-		
-		if(pc == cpu->PC)
-		{
-			cout<<"infinite loop at "<<hex<<unsigned(pc)<<endl;
-			break;
-
-		} else if(cpu->PC == 0x3463)
-		{
-			cout<<"test passed!"<<endl;
-			break;
-		}
-		
-		pc = cpu->PC;
-		
-		opcode = cpu->fetch();
-		cout<<"OPCODE: "<<hex<<unsigned(opcode)<<endl;
-
-		loop = cpu->decode(opcode);
-		if(loop == false){
-			cout<<"Bloccato "<<endl;
-		}
-
-		cpu->dump_reg();
+	signal(SIGTSTP,dump_cpu_handler);
+	signal(SIGINT,chiudi);
 
-	}
+	machine->run();
+
+	if(save_file != "" and !machine->save(save_file))
+		cout<<"Cannot save "<<save_file<<endl;
+
+	if(profiler)
+		profiler->report(machine->getMemory(),PROFILE_TOP_N);
 
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "modules/library.h"
+
+#include "modules/machine.h"
+
+//Cold boots a headless machine up to BASIC_READY and writes its snapshot as a C++ source
+//defining ready_snapshot, or as a plain snapshot file when the name does not end in .cpp
+int main(int argc, const char **argv){
+
+	if(argc != 2){
+		cout<<"Usage: "<<argv[0]<<" ready_snapshot.cpp|file.snap"<<endl;
+		return 2;
+	}
+
+	const string filename = argv[1];
+
+	Machine *machine = new Machine(nullptr);
+	CPU *cpu = machine->getCPU();
+
+	//Nobody watches the boot, no need for real time
+	machine->setWarp(true);
+
+	cpu->setBreakpoint(BASIC_READY);
+
+	while(cpu->PC != BASIC_READY)
+		machine->step();
+
+	cpu->clearBreakpoint();
+
+	Snapshot snapshot;
+	machine->save(snapshot);
+
+	delete machine;
+
+	if(filename.size() < 4 or filename.compare(filename.size() - 4, 4, ".cpp") != 0)
+		return snapshot.save(filename) ? 0 : 1;
+
+	ofstream file(filename);
+
+	if(!file.is_open())
+		return 1;
+
+	const uint8_t *data = snapshot.data();
+
+	file<<"//Generated by make_snapshot, do not edit"<<endl;
+	file<<"#include \"modules/snapshot.h\""<<endl<<endl;
+	file<<"const uint8_t ready_snapshot[] = {";
+
+	for(size_t i = 0; i < snapshot.size(); i++)
+		file<<((i % 16) ? "" : "\n\t")<<unsigned(data[i])<<",";
+
+	file<<endl<<"};"<<endl<<endl;
+	file<<"const size_t ready_snapshot_size = sizeof(ready_snapshot);"<<endl;
+
+	return file.good() ? 0 : 1;
+
+}
@@ -1,5 +1,7 @@
 #include "SDLManager.h"
 
+#include <SDL2/SDL.h>
+
 
 SDLManager::SDLManager(){
 
@@ -15,6 +17,9 @@ SDLManager::SDLManager(){
 
 	memset(&keyboard_matrix[0],0xFF,64);
 
+	rewind_request = false;
+	warp_request = false;
+
 }
 
 SDLManager::~SDLManager(){
@@ -75,20 +80,85 @@ void SDLManager::initialize_SDL(){
 
 }
 
-void SDLManager::render_frame(){
+void SDLManager::render_frame(const bool *changed_lines){
 
 	total_redraws++;
 
+	//A whole frame has an irq scanning the keyboard, the guest has seen the key by now
+	{
+		lock_guard<mutex> lock(input_mutex);
+		input_event = false;
+	}
+
 	if(texture == nullptr || renderer == nullptr)
 		return;
 
-	SDL_UpdateTexture(texture,NULL,video_memory,SCREEN_WIDTH * sizeof(host_pixel_t));
+	if(full_upload){
+		SDL_UpdateTexture(texture,NULL,video_memory,SCREEN_WIDTH * sizeof(host_pixel_t));
+		full_upload = false;
+
+	} else {
+
+		//One update for each span of consecutive lines
+		for(int line = 0; line < SCREEN_HEIGHT; ){
+
+			if(!changed_lines[line]){
+				line++;
+				continue;
+			}
+
+			int first = line;
+
+			while(line < SCREEN_HEIGHT and changed_lines[line])
+				line++;
+
+			SDL_Rect span = {0, first, SCREEN_WIDTH, line - first};
+			SDL_UpdateTexture(texture,&span,video_memory + first * SCREEN_WIDTH,SCREEN_WIDTH * sizeof(host_pixel_t));
+		}
+	}
+
 	SDL_RenderCopy( renderer, texture, NULL, NULL );
 	SDL_RenderPresent( renderer );
 
 }
 
 
+void SDLManager::waitForInput(chrono::steady_clock::time_point deadline){
+
+	unique_lock<mutex> lock(input_mutex);
+	input_cv.wait_until(lock, deadline, [this]{ return input_event; });
+
+}
+
+void SDLManager::notifyInput(){
+
+	{
+		lock_guard<mutex> lock(input_mutex);
+		input_event = true;
+	}
+
+	input_cv.notify_one();
+
+}
+
+bool SDLManager::rewindRequested(){
+
+	return rewind_request.exchange(false);
+
+}
+
+bool SDLManager::warpRequested(){
+
+	return warp_request.exchange(false);
+
+}
+
+bool SDLManager::isHotkey(uint16_t scancode){
+
+	return scancode == REWIND_KEY or scancode == WARP_KEY;
+
+}
+
 host_pixel_t* SDLManager::getVideoMemoryPtr(){
 
 	return video_memory;
@@ -127,6 +197,17 @@ void SDLManager::keyboard_loop(){
 		// We are only worried about SDL_KEYDOWN and SDL_KEYUP events
 			switch( event.type ){
 				case SDL_KEYDOWN:
+					//Host hotkeys never reach the keyboard matrix
+					if(event.key.keysym.scancode == REWIND_KEY){
+						rewind_request = true;
+						break;
+					}
+
+					if(event.key.keysym.scancode == WARP_KEY){
+						warp_request = true;
+						break;
+					}
+
 					cout<<"Key press detected: \n";
 					matrix = RowColFromScancode(event.key.keysym.scancode);
 					keyboard_matrix[matrix.row][matrix.col] = 0x00;
@@ -136,9 +217,13 @@ void SDLManager::keyboard_loop(){
 						keyboard_matrix[7][1] = 0x00;
 					}
 
+					notifyInput();
 					break;
 
 				case SDL_KEYUP:
+					if(isHotkey(event.key.keysym.scancode))
+						break;
+
 					cout<<"Key release detected\n";
 					matrix = RowColFromScancode(event.key.keysym.scancode);
 					keyboard_matrix[matrix.row][matrix.col] = 0xFF;
@@ -147,6 +232,7 @@ void SDLManager::keyboard_loop(){
 						keyboard_matrix[7][1] = 0xFF;
 					}
 
+					notifyInput();
 					break;
 
 				case SDL_QUIT:
@@ -5,12 +5,24 @@ class SDLManager;
 #include "vic.h"
 #include "cia1.h"
 
+#include <atomic>
+
+//SDL itself is included only where it is used, so the headless tools build without it
+struct SDL_Window;
+struct SDL_Renderer;
+struct SDL_Texture;
+struct SDL_PixelFormat;
+
 #define SCREEN_WIDTH 320
 #define SCREEN_HEIGHT 200
 
 #define KEYBOARD_COL_ADDR 0xDC00
 #define KEYBOARD_ROW_ADDR 0xDC01
 
+//Host hotkeys
+#define REWIND_KEY SDL_SCANCODE_F9
+#define WARP_KEY SDL_SCANCODE_F10
+
 
 struct KeyboardMatrix{
 
@@ -29,11 +41,21 @@ class SDLManager{
 		host_pixel_t* getVideoMemoryPtr();
 		SDL_PixelFormat* getPixelFormat();
 
-		void render_frame();
+		//Only the lines flagged are uploaded, the texture keeps the others
+		void render_frame(const bool*);
 
 		void checkFPS();
 		uint8_t getRowForCol(uint8_t);
 
+		//Blocks until a key event or the deadline, returns at once if a key came during this frame
+		void waitForInput(chrono::steady_clock::time_point);
+
+		//True once for each press of the rewind hotkey
+		bool rewindRequested();
+
+		//True once for each press of the warp hotkey
+		bool warpRequested();
+
 	private:
 		void initialize_SDL();
 		void keyboard_loop();
@@ -50,8 +72,25 @@ class SDLManager{
 		SDL_PixelFormat *format = nullptr;
 
 		uint8_t keyboard_matrix[8][8];
+
+		//Set by the keyboard thread, cleared once a frame has gone by
+		mutex input_mutex;
+		condition_variable input_cv;
+		bool input_event = false;
+
+		void notifyInput();
+
+		//Host hotkeys, set by the keyboard thread and taken by the emulation one
+		atomic<bool> rewind_request;
+		atomic<bool> warp_request;
+
+		bool isHotkey(uint16_t);
+
 		host_pixel_t *video_memory = nullptr;
 
+		//Until the texture has been filled once every line goes up
+		bool full_upload = true;
+
 		//DEBUG
 
 		uint64_t total_redraws;
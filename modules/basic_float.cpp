@@ -0,0 +1,758 @@
+#include "basic_float.h"
+
+//Zero page of the float package
+#define ZP_INDEX1 0x22
+#define ZP_ROUND_SAVE 0x56
+#define ZP_FAC_EXP 0x61
+#define ZP_FAC_SIGN 0x66
+#define ZP_FAC_OVERFLOW 0x68
+#define ZP_ARG_EXP 0x69
+#define ZP_ARG_SIGN 0x6E
+#define ZP_SIGN_COMPARE 0x6F
+#define ZP_FAC_ROUND 0x70
+#define ZP_PRODUCT 0x26
+
+//Entry points of SHIFTR
+#define SHIFTR_BYTES 0
+#define SHIFTR_ANY 1
+#define SHIFTR_BITS 2
+
+//Results of MULDIV
+#define MULDIV_CONTINUE 0
+#define MULDIV_ZERO 1
+#define MULDIV_OVERFLOW 2
+
+//The 6502 instructions the package uses, same flags as the real ones
+
+static inline void nz(fp_state &s, uint8_t val){
+	s.n = val & 0x80;
+	s.z = val == 0;
+}
+
+static inline void lda(fp_state &s, uint8_t val){
+	s.a = val;
+	nz(s, val);
+}
+
+static inline void adc(fp_state &s, uint8_t val){
+	uint16_t t = s.a + val + s.c;
+	s.v = (~(s.a ^ val) & (s.a ^ t) & 0x80) != 0;
+	s.c = t > 0xFF;
+	lda(s, t);
+}
+
+static inline void sbc(fp_state &s, uint8_t val){
+	adc(s, ~val);
+}
+
+static inline void cmp(fp_state &s, uint8_t reg, uint8_t val){
+	s.c = reg >= val;
+	nz(s, reg - val);
+}
+
+static inline void asl(fp_state &s, uint8_t &m){
+	s.c = m & 0x80;
+	m <<= 1;
+	nz(s, m);
+}
+
+static inline void lsr(fp_state &s, uint8_t &m){
+	s.c = m & 0x01;
+	m >>= 1;
+	nz(s, m);
+}
+
+static inline void rol(fp_state &s, uint8_t &m){
+	bool c = m & 0x80;
+	m = (m << 1) | s.c;
+	s.c = c;
+	nz(s, m);
+}
+
+static inline void ror(fp_state &s, uint8_t &m){
+	bool c = m & 0x01;
+	m = (m >> 1) | (s.c << 7);
+	s.c = c;
+	nz(s, m);
+}
+
+static inline void inc(fp_state &s, uint8_t &m){
+	m++;
+	nz(s, m);
+}
+
+BasicFloat::BasicFloat(CPU *cpu, Memory *memory){
+
+	this->cpu = cpu;
+	this->memory = memory;
+
+}
+
+//FSUB: ARG from memory at A/Y minus FAC, FSUBT: ARG minus FAC
+bool BasicFloat::fsub(bool unpack){
+
+	fp_state s;
+
+	if(!load(s))
+		return false;
+
+	if(unpack)
+		conupk(s);
+
+	lda(s, s.zp[ZP_FAC_SIGN] ^ 0xFF);
+	s.zp[ZP_FAC_SIGN] = s.a;
+	s.a ^= s.zp[ZP_ARG_SIGN];
+	nz(s, s.a);
+	s.zp[ZP_SIGN_COMPARE] = s.a;
+	lda(s, s.zp[ZP_FAC_EXP]);
+
+	if(!faddt(s))
+		return false;
+
+	commit(s);
+	return true;
+
+}
+
+//FADD: ARG from memory at A/Y plus FAC, FADDT: ARG plus FAC
+bool BasicFloat::fadd(bool unpack){
+
+	fp_state s;
+
+	if(!load(s))
+		return false;
+
+	if(unpack)
+		conupk(s);
+
+	if(!faddt(s))
+		return false;
+
+	commit(s);
+	return true;
+
+}
+
+//FMULT: ARG from memory at A/Y times FAC, FMULTT: ARG times FAC
+bool BasicFloat::fmult(bool unpack){
+
+	fp_state s;
+
+	if(!load(s))
+		return false;
+
+	if(unpack)
+		conupk(s);
+
+	//FAC is zero, so is the product
+	if(s.z){
+		commit(s);
+		return true;
+	}
+
+	switch(muldiv(s)){
+		case MULDIV_OVERFLOW:
+			return false;
+
+		case MULDIV_ZERO:
+			lda(s, 0);
+			s.zp[ZP_FAC_EXP] = 0;
+			s.zp[ZP_FAC_SIGN] = 0;
+			commit(s);
+			return true;
+	}
+
+	lda(s, 0);
+	for(uint8_t i = 0; i < 4; i++)
+		s.zp[ZP_PRODUCT + i] = 0;
+
+	//Least significant byte first, the top one never takes the shortcut for a zero byte
+	lda(s, s.zp[ZP_FAC_ROUND]);
+	mulbyte(s, true);
+	lda(s, s.zp[ZP_FAC_EXP + 4]);
+	mulbyte(s, true);
+	lda(s, s.zp[ZP_FAC_EXP + 3]);
+	mulbyte(s, true);
+	lda(s, s.zp[ZP_FAC_EXP + 2]);
+	mulbyte(s, true);
+	lda(s, s.zp[ZP_FAC_EXP + 1]);
+	mulbyte(s, false);
+
+	for(uint8_t i = 0; i < 4; i++){
+		lda(s, s.zp[ZP_PRODUCT + i]);
+		s.zp[ZP_FAC_EXP + 1 + i] = s.a;
+	}
+
+	if(!normalize(s))
+		return false;
+
+	commit(s);
+	return true;
+
+}
+
+//FDIV: ARG from memory at A/Y divided by FAC, FDIVT: ARG divided by FAC
+bool BasicFloat::fdiv(bool unpack){
+
+	fp_state s;
+
+	if(!load(s))
+		return false;
+
+	if(unpack)
+		conupk(s);
+
+	//DIVISION BY ZERO is raised by the ROM
+	if(s.z)
+		return false;
+
+	if(!round_up(s))
+		return false;
+
+	lda(s, 0);
+	s.c = true;
+	sbc(s, s.zp[ZP_FAC_EXP]);
+	s.zp[ZP_FAC_EXP] = s.a;
+
+	switch(muldiv(s)){
+		case MULDIV_OVERFLOW:
+			return false;
+
+		case MULDIV_ZERO:
+			lda(s, 0);
+			s.zp[ZP_FAC_EXP] = 0;
+			s.zp[ZP_FAC_SIGN] = 0;
+			commit(s);
+			return true;
+	}
+
+	inc(s, s.zp[ZP_FAC_EXP]);
+	if(s.z)
+		return false;
+
+	//Quotient bytes go to $26-$29 through X from $FC, wrapping in the zero page
+	s.x = 0xFC;
+	lda(s, 0x01);
+
+	bool saved_n = false, saved_z = false, saved_c = false, saved_v = false;
+
+	compare:
+		s.y = s.zp[ZP_ARG_EXP + 1];
+		cmp(s, s.y, s.zp[ZP_FAC_EXP + 1]);
+
+		for(uint8_t i = 2; i <= 4 and s.z; i++){
+			s.y = s.zp[ZP_ARG_EXP + i];
+			cmp(s, s.y, s.zp[ZP_FAC_EXP + i]);
+		}
+
+	quotient_bit:
+		saved_n = s.n;
+		saved_z = s.z;
+		saved_c = s.c;
+		saved_v = s.v;
+
+		rol(s, s.a);
+
+		if(s.c){
+			s.x++;
+			nz(s, s.x);
+			s.zp[(ZP_PRODUCT + 3 + s.x) & 0xFF] = s.a;
+
+			if(s.z){
+				lda(s, 0x40);
+			}
+			else{
+				if(!s.n)
+					goto done;
+
+				lda(s, 0x01);
+			}
+		}
+
+		s.n = saved_n;
+		s.z = saved_z;
+		s.c = saved_c;
+		s.v = saved_v;
+
+		if(s.c){
+			s.y = s.a;
+			nz(s, s.y);
+
+			for(uint8_t i = 4; i >= 1; i--){
+				lda(s, s.zp[ZP_ARG_EXP + i]);
+				sbc(s, s.zp[ZP_FAC_EXP + i]);
+				s.zp[ZP_ARG_EXP + i] = s.a;
+			}
+
+			s.a = s.y;
+			nz(s, s.a);
+		}
+
+		asl(s, s.zp[ZP_ARG_EXP + 4]);
+		rol(s, s.zp[ZP_ARG_EXP + 3]);
+		rol(s, s.zp[ZP_ARG_EXP + 2]);
+		rol(s, s.zp[ZP_ARG_EXP + 1]);
+
+		if(s.c or !s.n)
+			goto quotient_bit;
+
+		goto compare;
+
+	done:
+		for(uint8_t i = 0; i < 6; i++)
+			asl(s, s.a);
+
+		s.zp[ZP_FAC_ROUND] = s.a;
+
+		s.n = saved_n;
+		s.z = saved_z;
+		s.c = saved_c;
+		s.v = saved_v;
+
+		for(uint8_t i = 0; i < 4; i++){
+			lda(s, s.zp[ZP_PRODUCT + i]);
+			s.zp[ZP_FAC_EXP + 1 + i] = s.a;
+		}
+
+		if(!normalize(s))
+			return false;
+
+		commit(s);
+		return true;
+
+}
+
+//Registers and zero page from the CPU, decimal mode would change every ADC and SBC
+bool BasicFloat::load(fp_state &s){
+
+	registers &regs = cpu->regs;
+
+	if(regs.decimal_mode_flag)
+		return false;
+
+	s.a = regs.reg[regA];
+	s.x = regs.reg[regX];
+	s.y = regs.reg[regY];
+	s.n = regs.sign_flag();
+	s.z = regs.zero_flag();
+	s.c = regs.carry_flag;
+	s.v = regs.overflow_flag();
+
+	//All the package touches
+	for(uint16_t i = ZP_INDEX1; i <= ZP_FAC_ROUND; i++)
+		s.zp[i] = memory->read_zero_page(i);
+
+	return true;
+
+}
+
+//Changed zero page bytes and the registers back to the CPU
+void BasicFloat::commit(fp_state &s){
+
+	for(uint16_t i = ZP_INDEX1; i <= ZP_FAC_ROUND; i++)
+		memory->write_zero_page(i, s.zp[i]);
+
+	registers &regs = cpu->regs;
+
+	regs.reg[regA] = s.a;
+	regs.reg[regX] = s.x;
+	regs.reg[regY] = s.y;
+	regs.sign_zero_flags(s.n, s.z);
+	regs.carry_flag = s.c;
+	regs.overflow_flag(s.v);
+
+}
+
+//CONUPK $BA8C: the packed number at A/Y into ARG
+void BasicFloat::conupk(fp_state &s){
+
+	s.zp[ZP_INDEX1] = s.a;
+	s.zp[ZP_INDEX1 + 1] = s.y;
+
+	uint16_t addr = s.a | (s.y << 8);
+
+	s.y = 4;
+	lda(s, memory->read_byte(addr + 4));
+	s.zp[ZP_ARG_EXP + 4] = s.a;
+	s.y--;
+	lda(s, memory->read_byte(addr + 3));
+	s.zp[ZP_ARG_EXP + 3] = s.a;
+	s.y--;
+	lda(s, memory->read_byte(addr + 2));
+	s.zp[ZP_ARG_EXP + 2] = s.a;
+	s.y--;
+	lda(s, memory->read_byte(addr + 1));
+	s.zp[ZP_ARG_SIGN] = s.a;
+	s.a ^= s.zp[ZP_FAC_SIGN];
+	s.zp[ZP_SIGN_COMPARE] = s.a;
+	lda(s, s.zp[ZP_ARG_SIGN] | 0x80);
+	s.zp[ZP_ARG_EXP + 1] = s.a;
+	s.y--;
+	lda(s, memory->read_byte(addr));
+	s.zp[ZP_ARG_EXP] = s.a;
+	lda(s, s.zp[ZP_FAC_EXP]);
+
+}
+
+//MULDIV $BAB7: exponent and sign of a product or quotient
+int BasicFloat::muldiv(fp_state &s){
+
+	lda(s, s.zp[ZP_ARG_EXP]);
+	if(s.z)
+		return MULDIV_ZERO;
+
+	s.c = false;
+	adc(s, s.zp[ZP_FAC_EXP]);
+
+	if(s.c){
+		if(s.n)
+			return MULDIV_OVERFLOW;
+
+		s.c = false;
+	}
+	else if(!s.n)
+		return MULDIV_ZERO;
+
+	adc(s, 0x80);
+	s.zp[ZP_FAC_EXP] = s.a;
+
+	if(!s.z)
+		lda(s, s.zp[ZP_SIGN_COMPARE]);
+
+	s.zp[ZP_FAC_SIGN] = s.a;
+
+	return MULDIV_CONTINUE;
+
+}
+
+//$BA59: one multiplier byte in A, a zero byte just shifts the product right by 8 bits
+void BasicFloat::mulbyte(fp_state &s, bool skip_zero){
+
+	if(skip_zero and s.z){
+		s.x = ZP_PRODUCT - 1;
+		shiftr(s, SHIFTR_BYTES);
+		return;
+	}
+
+	lsr(s, s.a);
+	s.a |= 0x80;
+	nz(s, s.a);
+
+	do{
+		s.y = s.a;
+		nz(s, s.y);
+
+		if(s.c){
+			s.c = false;
+
+			for(uint8_t i = 4; i >= 1; i--){
+				lda(s, s.zp[ZP_PRODUCT - 1 + i]);
+				adc(s, s.zp[ZP_ARG_EXP + i]);
+				s.zp[ZP_PRODUCT - 1 + i] = s.a;
+			}
+		}
+
+		for(uint8_t i = 0; i < 4; i++)
+			ror(s, s.zp[ZP_PRODUCT + i]);
+
+		ror(s, s.zp[ZP_FAC_ROUND]);
+
+		s.a = s.y;
+		nz(s, s.a);
+		lsr(s, s.a);
+	} while(!s.z);
+
+}
+
+//SHIFTR: the mantissa at X+1 right by -A bits, from $B985 (a byte shift first), $B999
+//or $B9B0 (the middle of the bit loop, Y holding the count)
+void BasicFloat::shiftr(fp_state &s, int entry){
+
+	if(entry == SHIFTR_ANY)
+		goto any;
+
+	if(entry == SHIFTR_BITS)
+		goto bits;
+
+	byte_shift:
+		s.y = s.zp[(s.x + 4) & 0xFF];
+		s.zp[ZP_FAC_ROUND] = s.y;
+
+		for(uint8_t i = 3; i >= 1; i--){
+			s.y = s.zp[(s.x + i) & 0xFF];
+			s.zp[(s.x + i + 1) & 0xFF] = s.y;
+		}
+
+		s.y = s.zp[ZP_FAC_OVERFLOW];
+		nz(s, s.y);
+		s.zp[(s.x + 1) & 0xFF] = s.y;
+
+	any:
+		adc(s, 0x08);
+		if(s.n or s.z)
+			goto byte_shift;
+
+		sbc(s, 0x08);
+		s.y = s.a;
+		nz(s, s.y);
+		lda(s, s.zp[ZP_FAC_ROUND]);
+
+		if(s.c){
+			s.c = false;
+			return;
+		}
+
+	bit_shift:
+		{
+			uint8_t &top = s.zp[(s.x + 1) & 0xFF];
+
+			asl(s, top);
+			if(s.c)
+				inc(s, top);
+
+			ror(s, top);
+			ror(s, top);
+		}
+
+	bits:
+		for(uint8_t i = 2; i <= 4; i++)
+			ror(s, s.zp[(s.x + i) & 0xFF]);
+
+		ror(s, s.a);
+		s.y++;
+		nz(s, s.y);
+
+		if(!s.z)
+			goto bit_shift;
+
+		s.c = false;
+
+}
+
+//$B947: two's complement of FAC and its rounding byte, the sign flipped
+void BasicFloat::negate(fp_state &s){
+
+	lda(s, s.zp[ZP_FAC_SIGN] ^ 0xFF);
+	s.zp[ZP_FAC_SIGN] = s.a;
+
+	for(uint8_t i = 1; i <= 4; i++){
+		lda(s, s.zp[ZP_FAC_EXP + i] ^ 0xFF);
+		s.zp[ZP_FAC_EXP + i] = s.a;
+	}
+
+	lda(s, s.zp[ZP_FAC_ROUND] ^ 0xFF);
+	s.zp[ZP_FAC_ROUND] = s.a;
+
+	inc(s, s.zp[ZP_FAC_ROUND]);
+
+	for(uint8_t i = 4; i >= 1 and s.z; i--)
+		inc(s, s.zp[ZP_FAC_EXP + i]);
+
+}
+
+//NORMAL $B8D7 and its carry tail $B936, false on OVERFLOW
+bool BasicFloat::normalize(fp_state &s){
+
+	s.y = 0;
+	lda(s, s.y);
+	s.c = false;
+
+	while(true){
+		s.x = s.zp[ZP_FAC_EXP + 1];
+		nz(s, s.x);
+
+		if(!s.z)
+			break;
+
+		for(uint8_t i = 1; i <= 3; i++){
+			s.x = s.zp[ZP_FAC_EXP + i + 1];
+			s.zp[ZP_FAC_EXP + i] = s.x;
+		}
+
+		s.x = s.zp[ZP_FAC_ROUND];
+		nz(s, s.x);
+		s.zp[ZP_FAC_EXP + 4] = s.x;
+		s.zp[ZP_FAC_ROUND] = s.y;
+
+		adc(s, 0x08);
+		cmp(s, s.a, 0x20);
+
+		if(s.z){
+			lda(s, 0);
+			s.zp[ZP_FAC_EXP] = 0;
+			s.zp[ZP_FAC_SIGN] = 0;
+			return true;
+		}
+	}
+
+	while(!s.n){
+		adc(s, 0x01);
+		asl(s, s.zp[ZP_FAC_ROUND]);
+
+		for(uint8_t i = 4; i >= 1; i--)
+			rol(s, s.zp[ZP_FAC_EXP + i]);
+	}
+
+	s.c = true;
+	sbc(s, s.zp[ZP_FAC_EXP]);
+
+	if(s.c){
+		lda(s, 0);
+		s.zp[ZP_FAC_EXP] = 0;
+		s.zp[ZP_FAC_SIGN] = 0;
+		return true;
+	}
+
+	s.a ^= 0xFF;
+	nz(s, s.a);
+	adc(s, 0x01);
+	s.zp[ZP_FAC_EXP] = s.a;
+
+	if(!s.c)
+		return true;
+
+	return carry_in(s);
+
+}
+
+//$B938: the carry out of the mantissa back in at the top, false on OVERFLOW
+bool BasicFloat::carry_in(fp_state &s){
+
+	inc(s, s.zp[ZP_FAC_EXP]);
+	if(s.z)
+		return false;
+
+	for(uint8_t i = 1; i <= 4; i++)
+		ror(s, s.zp[ZP_FAC_EXP + i]);
+
+	ror(s, s.zp[ZP_FAC_ROUND]);
+
+	return true;
+
+}
+
+//$BC1B: FAC rounded by the top bit of its rounding byte, false on OVERFLOW
+bool BasicFloat::round_up(fp_state &s){
+
+	lda(s, s.zp[ZP_FAC_EXP]);
+	if(s.z)
+		return true;
+
+	asl(s, s.zp[ZP_FAC_ROUND]);
+	if(!s.c)
+		return true;
+
+	for(uint8_t i = 4; i >= 1; i--){
+		inc(s, s.zp[ZP_FAC_EXP + i]);
+		if(!s.z)
+			return true;
+	}
+
+	return carry_in(s);
+
+}
+
+//FADDT $B86A, with A holding the FAC exponent, false on OVERFLOW
+bool BasicFloat::faddt(fp_state &s){
+
+	//FAC is zero, the sum is ARG
+	if(s.z){
+		lda(s, s.zp[ZP_ARG_SIGN]);
+		s.zp[ZP_FAC_SIGN] = s.a;
+
+		for(s.x = 5; s.x != 0; s.x--){
+			lda(s, s.zp[ZP_FAC_OVERFLOW + s.x]);
+			s.zp[ZP_FAC_EXP - 1 + s.x] = s.a;
+		}
+
+		nz(s, s.x);
+		s.zp[ZP_FAC_ROUND] = s.x;
+		return true;
+	}
+
+	s.x = s.zp[ZP_FAC_ROUND];
+	s.zp[ZP_ROUND_SAVE] = s.x;
+	s.x = ZP_ARG_EXP;
+	lda(s, s.zp[ZP_ARG_EXP]);
+	s.y = s.a;
+
+	//ARG is zero, the sum is FAC
+	if(s.z)
+		return true;
+
+	s.c = true;
+	sbc(s, s.zp[ZP_FAC_EXP]);
+
+	//The smaller operand is aligned to the other one, X points to it
+	if(!s.z){
+		if(s.c){
+			s.zp[ZP_FAC_EXP] = s.y;
+			s.y = s.zp[ZP_ARG_SIGN];
+			s.zp[ZP_FAC_SIGN] = s.y;
+			s.a ^= 0xFF;
+			adc(s, 0x00);
+			s.y = 0;
+			s.zp[ZP_ROUND_SAVE] = s.y;
+			s.x = ZP_FAC_EXP;
+		}
+		else{
+			s.y = 0;
+			s.zp[ZP_FAC_ROUND] = s.y;
+		}
+
+		cmp(s, s.a, 0xF9);
+
+		if(s.n){
+			shiftr(s, SHIFTR_ANY);
+		}
+		else{
+			s.y = s.a;
+			lda(s, s.zp[ZP_FAC_ROUND]);
+			lsr(s, s.zp[(s.x + 1) & 0xFF]);
+			shiftr(s, SHIFTR_BITS);
+		}
+	}
+
+	//Same signs add up, different ones subtract
+	s.n = s.zp[ZP_SIGN_COMPARE] & 0x80;
+	s.v = s.zp[ZP_SIGN_COMPARE] & 0x40;
+	s.z = (s.a & s.zp[ZP_SIGN_COMPARE]) == 0;
+
+	if(!s.n){
+		adc(s, s.zp[ZP_ROUND_SAVE]);
+		s.zp[ZP_FAC_ROUND] = s.a;
+
+		for(uint8_t i = 4; i >= 1; i--){
+			lda(s, s.zp[ZP_FAC_EXP + i]);
+			adc(s, s.zp[ZP_ARG_EXP + i]);
+			s.zp[ZP_FAC_EXP + i] = s.a;
+		}
+
+		if(!s.c)
+			return true;
+
+		return carry_in(s);
+	}
+
+	//Y points to the operand that was not shifted
+	s.y = (s.x == ZP_ARG_EXP) ? ZP_FAC_EXP : ZP_ARG_EXP;
+	cmp(s, s.x, ZP_ARG_EXP);
+
+	s.c = true;
+	s.a ^= 0xFF;
+	nz(s, s.a);
+	adc(s, s.zp[ZP_ROUND_SAVE]);
+	s.zp[ZP_FAC_ROUND] = s.a;
+
+	for(uint8_t i = 4; i >= 1; i--){
+		lda(s, s.zp[s.y + i]);
+		sbc(s, s.zp[(s.x + i) & 0xFF]);
+		s.zp[ZP_FAC_EXP + i] = s.a;
+	}
+
+	if(!s.c)
+		negate(s);
+
+	return normalize(s);
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+class BasicFloat;
+
+#include "library.h"
+#include "cpu.h"
+#include "memory.h"
+
+//BASIC ROM floating point entry points, the T versions take ARG already unpacked
+#define FSUB_addr 0xB850
+#define FSUBT_addr 0xB853
+#define FADD_addr 0xB867
+#define FADDT_addr 0xB86A
+#define FMULT_addr 0xBA28
+#define FMULTT_addr 0xBA2B
+#define FDIV_addr 0xBB0F
+#define FDIVT_addr 0xBB12
+
+//6502 registers and zero page while a routine runs natively, written back only if it completes
+struct fp_state{
+	uint8_t a, x, y;
+	bool n, z, c, v;
+	uint8_t zp[256];
+};
+
+//The BASIC float package ported instruction by instruction, so FAC, ARG, the rounding byte,
+//the temporaries and the registers end up exactly as with the ROM code, quirks included.
+//A routine declines (returns false, nothing changed) where the ROM would raise an error
+class BasicFloat{
+
+	public:
+		BasicFloat(CPU*,Memory*);
+
+		bool fsub(bool);
+		bool fadd(bool);
+		bool fmult(bool);
+		bool fdiv(bool);
+
+	private:
+		CPU *cpu;
+		Memory *memory;
+
+		bool load(fp_state&);
+		void commit(fp_state&);
+
+		void conupk(fp_state&);
+		int muldiv(fp_state&);
+		void mulbyte(fp_state&, bool);
+		void shiftr(fp_state&, int);
+		void negate(fp_state&);
+		bool normalize(fp_state&);
+		bool round_up(fp_state&);
+		bool carry_in(fp_state&);
+		bool faddt(fp_state&);
+
+};
@@ -25,37 +25,64 @@ void CIA1::setSDL(SDLManager* sdl){
 	this->sdl = sdl;
 }
 
+//Whatever save puts
+const size_t CIA1::snapshot_size = sizeof(registers) + sizeof(timerA_latch) + sizeof(timerB_latch) + sizeof(timerA)
+	+ sizeof(timerB) + sizeof(timerA_enabled) + sizeof(timerB_enabled) + sizeof(timerA_irq_enabled)
+	+ sizeof(timerB_irq_enabled) + sizeof(timerA_irq_raised) + sizeof(timerB_irq_raised) + sizeof(timerA_reload)
+	+ sizeof(timerB_reload) + sizeof(timerA_sysclock) + sizeof(timerB_sysclock);
+
+void CIA1::save(Snapshot &snapshot){
+
+	snapshot.put(registers);
+
+	snapshot.put(timerA_latch);
+	snapshot.put(timerB_latch);
+	snapshot.put(timerA);
+	snapshot.put(timerB);
+
+	snapshot.put(timerA_enabled);
+	snapshot.put(timerB_enabled);
+	snapshot.put(timerA_irq_enabled);
+	snapshot.put(timerB_irq_enabled);
+	snapshot.put(timerA_irq_raised);
+	snapshot.put(timerB_irq_raised);
+	snapshot.put(timerA_reload);
+	snapshot.put(timerB_reload);
+	snapshot.put(timerA_sysclock);
+	snapshot.put(timerB_sysclock);
 
-void CIA1::clock(){
+}
 
-	if(timerA_enabled and timerA_sysclock){
-		//cout<<hex<<unsigned(timerA_latch)<<endl;
-		timerA--;
-	}
+void CIA1::restore(Snapshot &snapshot){
 
-	if(timerB_enabled and timerB_sysclock)
-		timerB--;
+	snapshot.get(registers);
 
-	if(timerA_irq_enabled and timerA_enabled and timerA == 0){
-		timerA_irq_raised = true;
-		/* Timer A reset */
+	snapshot.get(timerA_latch);
+	snapshot.get(timerB_latch);
+	snapshot.get(timerA);
+	snapshot.get(timerB);
 
-		if(timerA_reload)
-			timerA = timerA_latch;
-		else
-			timerA_enabled = false;
+	snapshot.get(timerA_enabled);
+	snapshot.get(timerB_enabled);
+	snapshot.get(timerA_irq_enabled);
+	snapshot.get(timerB_irq_enabled);
+	snapshot.get(timerA_irq_raised);
+	snapshot.get(timerB_irq_raised);
+	snapshot.get(timerA_reload);
+	snapshot.get(timerB_reload);
+	snapshot.get(timerA_sysclock);
+	snapshot.get(timerB_sysclock);
 
-	}
+}
 
-	if(timerB_irq_enabled and timerB_enabled and timerB == 0){
-		timerB_irq_raised = true;
-		/* Timer B reset */
 
-		if(timerB_reload)
-			timerB = timerB_latch;
-		else
-			timerB_enabled = false;
-	}
+void CIA1::clock(uint32_t cycles){
+
+	if(timerA_enabled and timerA_sysclock)
+		timerA_irq_raised |= count_down(timerA, timerA_latch, timerA_reload, timerA_irq_enabled, timerA_enabled, cycles);
+
+	if(timerB_enabled and timerB_sysclock)
+		timerB_irq_raised |= count_down(timerB, timerB_latch, timerB_reload, timerB_irq_enabled, timerB_enabled, cycles);
 
 	if((timerA_irq_raised and timerA_irq_enabled) or (timerB_irq_raised and timerB_irq_enabled)){
 		cpu->setIRQline();
@@ -64,6 +91,54 @@ void CIA1::clock(){
 
 }
 
+//Cycles until the first timer able to raise an irq underflows
+uint32_t CIA1::cycles_to_underflow(){
+
+	uint32_t cycles = UINT32_MAX;
+
+	if(timerA_enabled and timerA_sysclock and timerA_irq_enabled)
+		cycles = (timerA == 0) ? 0x10000 : timerA;
+
+	if(timerB_enabled and timerB_sysclock and timerB_irq_enabled)
+		cycles = min(cycles, (timerB == 0) ? 0x10000u : timerB);
+
+	return cycles;
+
+}
+
+//Decrements a timer by cycles at once, returns true if it underflowed meanwhile
+bool CIA1::count_down(uint16_t &timer, uint16_t latch, bool reload, bool irq_enabled, bool &enabled, uint32_t cycles){
+
+	//Without irq the timer just wraps around
+	if(!irq_enabled){
+		timer -= cycles;
+		return false;
+	}
+
+	uint32_t to_underflow = (timer == 0) ? 0x10000 : timer;
+
+	if(cycles < to_underflow){
+		timer -= cycles;
+		return false;
+	}
+
+	cycles -= to_underflow;
+
+	/* Timer reset */
+	if(!reload){
+		timer = 0;
+		enabled = false;
+		return true;
+	}
+
+	uint32_t period = (latch == 0) ? 0x10000 : latch;
+
+	timer = latch - (cycles % period);
+
+	return true;
+
+}
+
 uint8_t CIA1::read_register(uint16_t address){
 
 	//cout<<"reading from cia1"<<endl;
@@ -90,9 +165,9 @@ uint8_t CIA1::read_register(uint16_t address){
 			//}
 			return return_value;
 
-		//Keyboard column
+		//Keyboard column, no key is ever down on a headless machine
 		case KEYBOARD_ROW:		
-			return sdl->getRowForCol(registers[KEYBOARD_COL]);
+			return sdl ? sdl->getRowForCol(registers[KEYBOARD_COL]) : 0xFF;
 	}
 
 	return registers[address];
@@ -5,6 +5,7 @@ class CIA1;
 #include "library.h"
 #include "cpu.h"
 #include "SDLManager.h"
+#include "snapshot.h"
 
 
 #define TA_LOW 0x04
@@ -29,10 +30,16 @@ class CIA1
 		void write_register(uint16_t,uint8_t);
 
 		void setCPU(CPU*);
-		void clock();
+		void clock(uint32_t);
+		uint32_t cycles_to_underflow();
 
 		void setSDL(SDLManager*);
 
+		//Registers and timers
+		void save(Snapshot&);
+		void restore(Snapshot&);
+		static const size_t snapshot_size;
+
 
 	private:
 		uint8_t registers[16];
@@ -58,6 +65,8 @@ class CIA1
 		bool timerA_sysclock;
 		bool timerB_sysclock;
 
+		bool count_down(uint16_t&, uint16_t, bool, bool, bool&, uint32_t);
+
 		CPU *cpu;
 		SDLManager *sdl;
 
@@ -17,6 +17,12 @@ void CIA2::setSDL(SDLManager* sdl){
 	this->sdl = sdl;
 }
 
+void CIA2::setMemory(Memory* memory){
+
+	this->memory = memory;
+	memory->setVICBank(VICBank);
+}
+
 uint8_t CIA2::read_register(uint16_t address){
 
 	//Masking first byte
@@ -39,13 +45,31 @@ void CIA2::write_register(uint16_t address, uint8_t data){
 	//DD00
 	if(address == 0){
 		VICBank = (~data) & 0x03;
+
+		if(memory)
+			memory->setVICBank(VICBank);
 	}
 
 
 	registers[address] = data;
 }
 
-uint8_t CIA2::getVICBank(){
-	return VICBank;
+const size_t CIA2::snapshot_size = sizeof(registers) + sizeof(VICBank);
+
+void CIA2::save(Snapshot &snapshot){
+
+	snapshot.put(registers);
+	snapshot.put(VICBank);
+
+}
+
+void CIA2::restore(Snapshot &snapshot){
+
+	snapshot.get(registers);
+	snapshot.get(VICBank);
+
+	if(memory)
+		memory->setVICBank(VICBank);
+
 }
 
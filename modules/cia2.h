@@ -4,7 +4,9 @@ class CIA2;
 
 #include "library.h"
 #include "cpu.h"
+#include "memory.h"
 #include "SDLManager.h"
+#include "snapshot.h"
 
 class CIA2{
 
@@ -19,7 +21,14 @@ class CIA2{
 
 		void setSDL(SDLManager*);
 
-		uint8_t getVICBank();
+		//Told which bank the VIC sees whenever $DD00 changes it
+		void setMemory(Memory*);
+
+		uint8_t getVICBank(){ return VICBank; }
+
+		void save(Snapshot&);
+		void restore(Snapshot&);
+		static const size_t snapshot_size;
 
 	private:
 		uint8_t registers[16];
@@ -28,5 +37,6 @@ class CIA2{
 
 		CPU *cpu;
 		SDLManager *sdl;
+		Memory *memory = nullptr;
 
 };
\ No newline at end of file
@@ -1,22 +1,56 @@
 #pragma once
 
 class CPU;
+class Traps;
 
 #include "library.h"
 #include "memory.h"
+#include "opcodes.h"
+#include "profiler.h"
+#include "tracer.h"
+#include "snapshot.h"
 
 #define RESET_routine 0xFCE2
 
-#define SET_ZF(val)     (regs.zero_flag = 	!(uint8_t)(val))
-#define SET_NF(val)     (regs.sign_flag =  	((uint8_t)(val) & 0x80 ))
+//Out of the 16 bit address space, PC never matches it
+#define NO_BREAKPOINT 0x10000
+#define NO_IDLE_LOOP 0x10000
+
+//Longest backward jump checked for an idle loop
+#define IDLE_LOOP_MAX_BYTES 16
+
+//Interrupts to take before the next instruction
+#define IRQ_PENDING 0x1
+#define NMI_PENDING 0x2
+
+//N and Z are derived from the stored result only when someone reads them
+#define SET_NZ(val)     (regs.nz_result = (uint8_t)(val))
+
+//V is derived as for an ADC of m to a giving r, SBC stores ~m
+#define SET_V(a,m,r)    (regs.v_a = (a), regs.v_m = (m), regs.v_r = (r))
+
+//Decoded instruction cache entry, valid while generation matches its slot
+struct decoded_op{
+	uint32_t generation;
+	uint16_t operand;
+	uint8_t opcode;
+	uint8_t length;
+};
+
+struct decoded_page{
+	decoded_op ops[256] = {};
+};
 
 class CPU
 {
+	//Native KERNAL routines return through RTS and change the I flag
+	friend class Traps;
 
 	public:
 
 		CPU(Memory *);
 		CPU(Memory *,uint16_t);
+		~CPU();
 
 		uint8_t fetch();
 		bool decode(uint8_t);
@@ -30,40 +64,102 @@ class CPU
 		void setIRQline();
 		void resetIRQline();
 
-		bool nmi_line;
+		//Edge triggered, only the high to low transition raises an NMI
+		void setNMIline();
+		void resetNMIline();
+
 		registers regs;
 
 		void clock();
 
+		//Runs whole instructions until budget cycles are spent, returns the overshoot
+		//(negative when it stops early on the breakpoint)
+		int32_t run(uint32_t);
+
+		void setBreakpoint(uint16_t);
+		void clearBreakpoint();
+
+		//Optional, they see every instruction executed through run()
+		void setProfiler(Profiler*);
+		void setTracer(Tracer*);
+
+		//Optional, native routines run in place of the ROM ones they are enabled for
+		void setTraps(Traps*);
+
+		//Registers, interrupt lines and counters, the breakpoint is left as it is
+		void save(Snapshot&);
+		void restore(Snapshot&);
+		static const size_t snapshot_size;
+
 		uint16_t PC;
-		uint16_t SP;
+		uint8_t SP;
+
+		//Totals of everything run through execute()
+		uint64_t cycles_executed;
+		uint64_t instructions_executed;
 
 	private:
 
 		uint16_t clocks_before_fetch;
+		uint32_t breakpoint;
 
 		Memory *memory;
+		Profiler *profiler = nullptr;
+		Tracer *tracer = nullptr;
+		Traps *traps = nullptr;
+
+		//Decoded instruction cache, one page per code slot of Memory
+		decoded_page *icache[CODE_SLOTS];
+		uint32_t icache_generation[CODE_SLOTS];
+
+		//Operand bytes of the instruction being executed
+		uint16_t operand;
+
+		//State seen at the target of the last short backward jump
+		uint32_t idle_pc;
+		uint8_t idle_reg[3];
+		uint8_t idle_SP;
+		uint8_t idle_flags;
+		uint32_t idle_writes;
+
+		bool idle_loop(uint16_t);
+
+		uint8_t fetch_uncached();
 
 		uint8_t irq_counter;
 
 		//IRQs
 		bool irq_line;
+		bool nmi_line;
+
+		//IRQ_PENDING and NMI_PENDING, kept up to date by the lines and the I flag
+		uint8_t pending;
+
+		void update_pending_irq();
+		void set_interrupt_flag(bool);
 
 		void handle_irq();
 		void handle_nmi();
 
 		//Memory Addressing Modes
 		uint8_t immediate();
-		
+
 		uint16_t absolute();
-		uint16_t absolute(register_name);
+		template<register_name> uint16_t absolute();
 
 		uint16_t zero_page();
-		uint16_t zero_page(register_name);
+		template<register_name> uint16_t zero_page();
 
+		uint16_t indirect();
 		uint16_t indirect_Y();
 		uint16_t indirect_X();
 
+		//Specialized per opcode, index registers and memory access are resolved at compile time
+		template<addressing_mode> uint16_t address();
+		template<addressing_mode> uint8_t load();
+		template<addressing_mode> void store(uint16_t, uint8_t);
+		template<addressing_mode, uint8_t (CPU::*)(uint8_t)> void modify();
+
 		uint8_t flags();
 		void reset_flags();
 
@@ -71,65 +167,39 @@ class CPU
 
 		//Istructions
 
-		void LD(register_name, uint8_t);
-		void ST(register_name, uint16_t);
-
-		void TSX();
+		template<register_name> void LD(uint8_t);
+		template<addressing_mode, register_name> void ST();
+		template<register_name> void CP(uint8_t);
 
-		void PUSH(register_name);
 		void PUSH(uint8_t);
 		uint8_t POP();
 
 		void BRK();
 		void RTI();
-
-		void PLA();
-		
-		void JMP(uint16_t);
+		void RTS();
 		void JSR(uint16_t);
-		void CMP_addr(uint16_t);
-		void CMP_data(uint8_t);
-		
-		void CPX(uint8_t);
-
-		void BNE(uint8_t);
-		void BEQ(uint8_t);
-		void BCS(uint8_t);
-		void BCC(uint8_t);
-		void BPL(uint8_t);
-		void BMI(uint8_t);
-		void BVS(uint8_t);
-		void BVC(uint8_t);
-
-		void DE(register_name);
-		void DEC(uint16_t);
-
-		void INC(register_name index);
-		void INC(uint16_t);
-		void ADC(uint8_t);
-		void SBC(uint8_t);
 
-		void CP(register_name, uint8_t);
+		//They return true when the jump closed an idle loop
+		bool jump(uint16_t);
+		bool branch(bool);
 
-		void OR(register_name, uint8_t);
+		void ORA(uint8_t);
 		void AND(uint8_t);
-		void ROL(register_name);
-		void LSR(register_name);
-		void ROR();
-		void ASL(register_name);
-
-		void left_shift_mem(uint16_t);
-		void right_shift_mem(uint16_t);
-		
-		void rotate_left_mem(uint16_t);
-		void rotate_right_mem(uint16_t);
-
 		void EOR(uint8_t);
-		void BIT(uint16_t);
+		void ADC(uint8_t);
+		void SBC(uint8_t);
+		void BIT(uint8_t);
+
+		//Read-modify-write, they return the value to write back
+		uint8_t ASL(uint8_t);
+		uint8_t LSR(uint8_t);
+		uint8_t ROL(uint8_t);
+		uint8_t ROR(uint8_t);
+		uint8_t INC(uint8_t);
+		uint8_t DEC(uint8_t);
 
-		void TAX();
-		void TAY();
-		void TXA();
+		void illegal(uint8_t);
 
+		uint32_t execute(uint8_t, uint32_t);
 
 };
\ No newline at end of file
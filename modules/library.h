@@ -5,17 +5,17 @@
 #include <string>
 #include <cstdint>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
 #include <signal.h>
 
-#include <SDL2/SDL.h>
-
 #include "debug.h"
 
 using namespace std;
 
-#define KERNAL_BASIC_ROM "roms/251913-01.bin"
-#define CHARSET_ROM "roms/901225-01.bin"
-
 #define fourK 4096
 #define eightK 8192
 #define sixteenK  16384
@@ -27,6 +27,8 @@ using namespace std;
 #define BASIC_START 0xA000
 #define BASIC_END 0xBFFF
 
+#define UPPER_RAM_START 0xC000
+
 #define ZERO_START 0x0000
 #define ZERO_END 0x00FF
 
@@ -50,6 +52,25 @@ using namespace std;
 
 #define RESET_routine 0xFCE2
 
+//KERNAL loop waiting for a key, spins while the keyboard buffer is empty
+#define KEYBOARD_WAIT_START 0xE5CD
+#define KEYBOARD_WAIT_END 0xE5D5
+#define KEYBOARD_BUFFER_LEN 0xC6
+
+//Decoded instruction cache slots: RAM pages, then BASIC and KERNAL ROM pages
+#define CODE_SLOT_BASIC 256
+#define CODE_SLOT_KERNAL (CODE_SLOT_BASIC + 32)
+#define CODE_SLOTS (CODE_SLOT_KERNAL + 32)
+#define NO_CODE_SLOT -1
+
+//RAM and color RAM written, in blocks of 64 bytes, so the VIC redraws only what changed
+#define VIDEO_BLOCK_SHIFT 6
+
+struct video_writes{
+	uint64_t ram[sixtyfourK >> VIDEO_BLOCK_SHIFT >> 6];
+	uint64_t color;
+};
+
 #define NMI_vector 0xFF43
 #define RESET_vector 0xFFFC
 #define IRQ_vector 0xFFFE
@@ -75,16 +96,27 @@ struct registers{
 	//uint8_t SP;
 	//uint16_t PC;
 
-	bool sign_flag;
-	bool overflow_flag;
-	bool zero_flag;
+	//Lazy flags: N and Z come from the last result, bit 8 forces N (BIT, PLP)
+	uint16_t nz_result;
+
+	//Lazy flags: V comes from the operands and the result of the last ADC/SBC
+	uint8_t v_a;
+	uint8_t v_m;
+	uint8_t v_r;
+
 	bool carry_flag;
 	bool interrupt_flag;
 	bool decimal_mode_flag;
 	bool break_flag;
 
 	uint8_t flags;
+
+	bool sign_flag() const { return (nz_result & 0x180) != 0; }
+	bool zero_flag() const { return (nz_result & 0xFF) == 0; }
+	bool overflow_flag() const { return (~(v_a ^ v_m) & (v_a ^ v_r) & 0x80) != 0; }
+
+	void sign_zero_flags(bool n, bool z) { nz_result = (n << 8) | !z; }
+	void overflow_flag(bool v) { v_a = v_m = 0; v_r = v << 7; }
 };
 
 void hexDump(void*, uint16_t);
-uint8_t* readBinFile(const string&, streampos &);
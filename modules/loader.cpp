@@ -6,8 +6,11 @@ Loader::Loader(CPU* cpu, Memory* memory, const string& filename){
 	this->cpu = cpu;
 	this->mem = memory;
 
-	if(filename != "")
+	if(filename != ""){
 		shouldLoad = true;
+		//CPU::run stops there, so the check in clock() can't miss it
+		cpu->setBreakpoint(BASIC_READY);
+	}
 }
 
 void Loader::clock(){
@@ -16,9 +19,13 @@ void Loader::clock(){
 		return;
 
 	if(!loaded && cpu->PC == BASIC_READY){
-		mem->loadPrg(filename);
+		cpu->clearBreakpoint();
 		loaded = true;
-		cout<<"Loaded!"<<endl;
+
+		if(mem->loadPrg(filename))
+			cout<<"Loaded!"<<endl;
+		else
+			cout<<"Cannot load "<<filename<<endl;
 	}
 
 }
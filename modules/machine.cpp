@@ -0,0 +1,265 @@
+#include "machine.h"
+
+Machine::Machine(SDLManager *sdl, const string &filename){
+
+	this->sdl = sdl;
+
+	running = true;
+
+	memory = new Memory();
+
+	cpu = new CPU(memory);
+	vic = new VIC();
+	cia1 = new CIA1();
+	cia2 = new CIA2();
+
+	connect();
+
+	if(sdl)
+		vic->setSDL(sdl);
+	else
+		vic->setHeadless();
+
+	if(filename != "")
+		loader = new Loader(cpu,memory,filename);
+
+}
+
+Machine::Machine(const Machine &parent){
+
+	sdl = nullptr;
+
+	running = true;
+
+	memory = new Memory(*parent.memory);
+
+	cpu = new CPU(memory);
+	vic = new VIC();
+	cia1 = new CIA1();
+	cia2 = new CIA2();
+
+	connect();
+
+	vic->setHeadless();
+
+	//CPU and devices hold about a kilobyte, they go through a snapshot
+	Snapshot devices;
+
+	parent.cpu->save(devices);
+	parent.vic->save(devices);
+	parent.cia1->save(devices);
+	parent.cia2->save(devices);
+
+	cpu->restore(devices);
+	vic->restore(devices);
+	cia1->restore(devices);
+	cia2->restore(devices);
+
+	vic->setWarp(parent.vic->isWarp());
+
+}
+
+Machine* Machine::fork(){
+
+	return new Machine(*this);
+
+}
+
+void Machine::connect(){
+
+	cia1->setCPU(cpu);
+	cia1->setSDL(sdl);
+
+	cia2->setCPU(cpu);
+	cia2->setSDL(sdl);
+	cia2->setMemory(memory);
+
+	memory->setVIC(vic);
+	memory->setCIA1(cia1);
+	memory->setCIA2(cia2);
+
+	vic->setMemory(memory);
+	vic->setCPU(cpu);
+	vic->setCIA1(cia1);
+	vic->setCIA2(cia2);
+
+}
+
+Machine::~Machine(){
+
+	delete loader;
+	delete traps;
+
+	delete cia2;
+	delete cia1;
+	delete vic;
+	delete cpu;
+	delete memory;
+
+}
+
+void Machine::step(){
+
+	//First, so a snapshot restored at BASIC_READY loads the program right away
+	if(loader)
+		loader->clock();
+
+	uint32_t budget = min(vic->cycles_to_next_line(), cia1->cycles_to_underflow());
+	uint32_t cycles = budget + cpu->run(budget);
+
+	cia1->clock(cycles);
+	vic->clock(cycles);
+
+	if(rewind){
+		rewind->clock();
+
+		if(sdl and sdl->rewindRequested())
+			rewind->back(REWIND_HOTKEY_SECONDS);
+	}
+
+	//Nothing to do before a key comes or the frame is due, then the frame catches up at once
+	if(sdl and waiting_for_key())
+		sdl->waitForInput(vic->frame_deadline());
+
+}
+
+void Machine::run(){
+
+	while(running)
+		step();
+
+}
+
+void Machine::stop(){
+
+	running = false;
+
+}
+
+bool Machine::waiting_for_key(){
+
+	return cpu->PC >= KEYBOARD_WAIT_START and cpu->PC <= KEYBOARD_WAIT_END
+		and memory->read_byte(KEYBOARD_BUFFER_LEN) == 0;
+
+}
+
+void Machine::setProfiler(Profiler *profiler){
+
+	cpu->setProfiler(profiler);
+
+}
+
+void Machine::setTracer(Tracer *tracer){
+
+	cpu->setTracer(tracer);
+
+}
+
+void Machine::setRewind(Rewind *rewind){
+
+	this->rewind = rewind;
+
+}
+
+void Machine::setWarp(bool warp){
+
+	vic->setWarp(warp);
+
+}
+
+bool Machine::loadKernalAndBasic(const string &filename){
+
+	return memory->load_kernal_and_basic(filename);
+
+}
+
+bool Machine::loadCharset(const string &filename){
+
+	return memory->load_charset(filename);
+
+}
+
+bool Machine::enableTrap(const string &name){
+
+	if(traps == nullptr){
+		traps = new Traps(cpu,memory);
+		traps->setLoadDirectory(load_directory);
+		cpu->setTraps(traps);
+	}
+
+	return traps->enable(name);
+
+}
+
+void Machine::setLoadDirectory(const string &directory){
+
+	load_directory = directory;
+
+	if(traps)
+		traps->setLoadDirectory(directory);
+
+}
+
+void Machine::save(Snapshot &snapshot){
+
+	cpu->save(snapshot);
+	memory->save(snapshot);
+	vic->save(snapshot);
+	cia1->save(snapshot);
+	cia2->save(snapshot);
+
+}
+
+bool Machine::restore(Snapshot &snapshot){
+
+	//Every field has a fixed size, so a snapshot of ours is always this long
+	static const size_t expected_size = sizeof(snapshot_header) + CPU::snapshot_size + Memory::snapshot_size
+		+ VIC::snapshot_size + CIA1::snapshot_size + CIA2::snapshot_size;
+
+	if(!snapshot.valid() or snapshot.size() != expected_size)
+		return false;
+
+	cpu->restore(snapshot);
+	memory->restore(snapshot);
+	vic->restore(snapshot);
+	cia1->restore(snapshot);
+	cia2->restore(snapshot);
+
+	return snapshot.valid();
+
+}
+
+bool Machine::save(const string &filename){
+
+	Snapshot snapshot;
+	save(snapshot);
+
+	return snapshot.save(filename);
+
+}
+
+bool Machine::restore(const string &filename){
+
+	Snapshot snapshot;
+
+	return snapshot.load(filename) and restore(snapshot);
+
+}
+
+CPU* Machine::getCPU(){
+
+	return cpu;
+
+}
+
+Memory* Machine::getMemory(){
+
+	return memory;
+
+}
+
+VIC* Machine::getVIC(){
+
+	return vic;
+
+}
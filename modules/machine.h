@@ -0,0 +1,96 @@
+#pragma once
+
+class Machine;
+
+#include "library.h"
+
+#include "memory.h"
+#include "cpu.h"
+#include "vic.h"
+#include "cia1.h"
+#include "cia2.h"
+#include "loader.h"
+#include "traps.h"
+#include "SDLManager.h"
+#include "snapshot.h"
+#include "rewind.h"
+
+#include <atomic>
+
+//A whole C64, everything it needs is owned here so any number of them can run,
+//each on its own thread
+class Machine{
+
+	public:
+		//Without an SDLManager the machine is headless: no window and no keyboard.
+		//A filename is loaded and run once BASIC is ready
+		Machine(SDLManager*, const string& = "");
+		~Machine();
+
+		//Headless copy of this machine, the RAM pages are shared until either one writes them.
+		//Call it from the thread running this machine, the fork can run on any other.
+		//Profiler, tracer, traps and loader are not inherited
+		Machine* fork();
+
+		//CPU up to the next rasterline or timer irq, the rest of the machine catches up after
+		void step();
+
+		//Steps until stop(), which can be called from any thread or a signal handler
+		void run();
+		void stop();
+
+		//The KERNAL is spinning on an empty keyboard buffer
+		bool waiting_for_key();
+
+		//Optional, owned by the caller
+		void setProfiler(Profiler*);
+		void setTracer(Tracer*);
+		void setRewind(Rewind*);
+
+		//As fast as the host can run, see VIC::setWarp. Forks inherit it
+		void setWarp(bool);
+
+		//Instead of the ROMs built in, before running. Forks share them.
+		//False, with the built in ones kept, if the file is missing or too short
+		bool loadKernalAndBasic(const string&);
+		bool loadCharset(const string&);
+
+		//By name as in Traps, false if there is no such trap
+		bool enableTrap(const string&);
+
+		//Where the LOAD trap reads files, see Traps::setLoadDirectory
+		void setLoadDirectory(const string&);
+
+		//CPU, RAM, bank modes, VIC and CIAs. Restore returns false, with the machine untouched,
+		//if the header is not of this version or the size is not what save would write
+		void save(Snapshot&);
+		bool restore(Snapshot&);
+
+		bool save(const string&);
+		bool restore(const string&);
+
+		CPU* getCPU();
+		Memory* getMemory();
+		VIC* getVIC();
+
+	private:
+		Memory *memory;
+		CPU *cpu;
+		VIC *vic;
+		CIA1 *cia1;
+		CIA2 *cia2;
+		Loader *loader = nullptr;
+		Traps *traps = nullptr;
+		Rewind *rewind = nullptr;
+
+		string load_directory = DEFAULT_LOAD_DIR;
+
+		SDLManager *sdl;
+
+		atomic<bool> running;
+
+		Machine(const Machine&);
+
+		void connect();
+
+};
@@ -0,0 +1,75 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(){
+
+}
+
+MappedFile::~MappedFile(){
+
+	close();
+
+}
+
+bool MappedFile::open(const string &filename){
+
+	close();
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+
+	if(fd < 0)
+		return false;
+
+	struct stat info;
+
+	if(fstat(fd, &info) != 0 or info.st_size <= 0){
+		::close(fd);
+		return false;
+	}
+
+	void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	//The mapping stays valid without the descriptor
+	::close(fd);
+
+	if(mapping == MAP_FAILED)
+		return false;
+
+	bytes = (const uint8_t*)mapping;
+	length = info.st_size;
+
+	return true;
+
+}
+
+void MappedFile::close(){
+
+	if(bytes)
+		munmap((void*)bytes, length);
+
+	bytes = nullptr;
+	length = 0;
+
+}
+
+bool MappedFile::valid(){
+
+	return bytes != nullptr;
+
+}
+
+const uint8_t* MappedFile::data(){
+
+	return bytes;
+
+}
+
+size_t MappedFile::size(){
+
+	return length;
+
+}
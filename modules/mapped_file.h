@@ -0,0 +1,32 @@
+#pragma once
+
+class MappedFile;
+
+#include "library.h"
+
+//A file mapped read-only, its pages come straight from the page cache and are
+//shared with every process mapping the same file
+class MappedFile{
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		//Unmaps the file held, if any. False if the file is missing, empty or can't be mapped
+		bool open(const string&);
+
+		bool valid();
+
+		const uint8_t* data();
+		size_t size();
+
+	private:
+		const uint8_t *bytes = nullptr;
+		size_t length = 0;
+
+		void close();
+
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+};
@@ -8,30 +8,113 @@ Memory::Memory(){
 	HIRAM_mode = RAM;
 	CHAR_mode = RAM;
 
-	basic = new uint8_t[eightK];
-	kernal = new uint8_t[eightK];
-	charset = new uint8_t[fourK];
-	memory = new uint8_t[sixtyfourK];
+	roms = new rom_images();
+	roms->refs = 1;
+
+	//Nothing to read at startup, the pages are touched only when the CPU gets there
+	roms->basic = kernal_basic_rom;
+	roms->kernal = kernal_basic_rom + eightK;
+	roms->charset = charset_rom;
+
+	basic = roms->basic;
+	kernal = roms->kernal;
+	charset = roms->charset;
+
+	//clearing RAM and color ram, so every machine boots the same way
+	for(int page = 0; page < 256; page++){
+		pages[page] = new ram_page();
+		pages[page]->refs = 1;
+	}
 
 	color_ram = new uint8_t[1000];
-
-	//clearing video mem and color ram
-	memset(memory+0x400,0,1000);
 	memset(color_ram,0,1000);
 
+	//Nothing has been decoded or drawn yet
+	memset(dirty_pages,0xFF,sizeof(dirty_pages));
+	memset(&written,0xFF,sizeof(written));
+
+	detach_io();
+
+	build_maps();
 	bankSwitch(LORAM_MASK | HIRAM_MASK | CHAREN_MASK);
 
+	build_vic_views();
+	setVICBank(0);
+
+}
+
+Memory::Memory(const Memory &parent){
+
+	roms = parent.roms;
+	roms->refs++;
+
+	basic = roms->basic;
+	kernal = roms->kernal;
+	charset = roms->charset;
+
+	for(int page = 0; page < 256; page++){
+		pages[page] = parent.pages[page];
+		pages[page]->refs++;
+	}
+
+	color_ram = new uint8_t[1000];
+	memcpy(color_ram,parent.color_ram,1000);
+
+	LORAM_mode = parent.LORAM_mode;
+	HIRAM_mode = parent.HIRAM_mode;
+	CHAR_mode = parent.CHAR_mode;
+	memcpy(code_slot,parent.code_slot,sizeof(code_slot));
+
+	detach_io();
+
+	map = parent.map;
+
+	setVICBank(parent.vic_bank_start / VIC_BANK_PAGES);
+
+	//Nothing has been decoded by this CPU or drawn by this VIC yet
+	memset(dirty_pages,0xFF,sizeof(dirty_pages));
+	memset(&written,0xFF,sizeof(written));
+
 }
 
 Memory::~Memory(){
 
-	delete[] basic;
-	delete[] kernal;
-	delete[] charset;
-	delete[] memory;
+	//The last one holding a page or the ROMs frees them
+	for(int page = 0; page < 256; page++)
+		if(pages[page]->refs.fetch_sub(1, memory_order_acq_rel) == 1)
+			delete pages[page];
+
+	if(roms->refs.fetch_sub(1, memory_order_acq_rel) == 1)
+		delete roms;
+
 	delete[] color_ram;
 }
 
+//A private copy of a shared page, the original goes to whoever still holds it
+void Memory::unshare(uint8_t page){
+
+	ram_page *copy = new ram_page();
+	memcpy(copy->bytes, pages[page]->bytes, sizeof(copy->bytes));
+	copy->refs = 1;
+
+	if(pages[page]->refs.fetch_sub(1, memory_order_acq_rel) == 1)
+		delete pages[page];
+
+	pages[page] = copy;
+
+}
+
+//Copies into RAM whatever the banks, marking the pages written
+void Memory::write_ram(uint16_t addr, const uint8_t *data, uint32_t size){
+
+	for(uint32_t i = 0; i < size and addr + i < sixtyfourK; i++)
+		writable((addr + i) >> 8)[(addr + i) & 0xFF] = data[i];
+
+	markDirty(addr, size);
+	write_count++;
+
+}
+
 void Memory::dump_memory(uint16_t addr,uint16_t bytes){
 
 	cout<<endl<<"---------------------"<<endl;
@@ -69,62 +152,54 @@ void Memory::dump_color_memory(){
 
 }
 
-uint8_t Memory::read_byte(uint16_t addr){
+//Nothing but color RAM until the devices are attached
+void Memory::detach_io(){
 
-	//uint16_t page = addr & 0xff00;
+	io_handler open = { this, &open_io_read, &open_io_write };
+	io_handler color = { this, &color_ram_read, &color_ram_write };
 
-	//TODO: implementare cartridge!
-	if(addr >= BASIC_START and addr <= BASIC_END){
-		
-		if(LORAM_mode == RAM)
-			return memory[addr];
-		else
-			return basic[addr-BASIC_START];
-	
-	//I/O CHAR or RAM
-	} else if(addr >= IO_START and addr <= IO_END){
+	for(int page = 0; page < IO_PAGES; page++)
+		io_handlers[page] = open;
 
-		if(CHAR_mode == RAM)
-			return memory[addr];
+	for(int page = (COLOR_RAM_START >> 8); page <= (COLOR_RAM_END >> 8); page++)
+		io_handlers[IO_PAGE(page << 8)] = color;
 
-		else if(CHAR_mode == ROM)								//Charset
-			return charset[addr-IO_START];
+}
 
-		else if(CHAR_mode == IO){								//Multiplexing on IO peripherals			
+uint8_t Memory::open_io_read(void*, uint16_t){
 
-			if(addr >= VIC_START && addr <= VIC_END){			//VIC
+	//Unimplemented
+	return 0xFF;
 
-				return vic->read_register(addr);
+}
 
-			} else if(addr >= CIA1_START and addr <= CIA1_END){		//CIA1
+void Memory::open_io_write(void *memory, uint16_t addr, uint8_t data){
 
-				return cia1->read_register(addr);
+	((Memory*)memory)->video_write(addr);
+	((Memory*)memory)->writable(addr >> 8)[addr & 0xFF] = data;
 
-			} else if(addr >= CIA2_START and addr <= CIA2_END){		//CIA2
+}
 
-				return cia2->read_register(addr);
+//1000 bytes, the last ones of $DB00 are left open
+uint8_t Memory::color_ram_read(void *memory, uint16_t addr){
 
-			} else if(addr >= COLOR_RAM_START && addr <= COLOR_RAM_END){
+	if(addr > COLOR_RAM_END)
+		return open_io_read(memory, addr);
 
-				return color_ram[addr - COLOR_RAM_START];
+	return ((Memory*)memory)->color_ram[addr - COLOR_RAM_START];
 
-			} else {
-				//Unimplemented
-				return 0xFF;
-			}
+}
+
+void Memory::color_ram_write(void *memory, uint16_t addr, uint8_t data){
+
+	if(addr > COLOR_RAM_END){
+		open_io_write(memory, addr, data);
+		return;
+	}
+
+	((Memory*)memory)->color_ram[addr - COLOR_RAM_START] = data;
+	((Memory*)memory)->written.color |= 1ULL << ((addr - COLOR_RAM_START) >> VIDEO_BLOCK_SHIFT);
 
-		}
-	
-	}  else if(addr >= KERNAL_START /*and addr <= KERNAL_END  inutile */){
-		
-		if(HIRAM_mode == RAM)
-			return memory[addr];
-		else
-			return kernal[addr-KERNAL_START];
-	
-	} 
-	
-	return memory[addr];
 }
 
 uint16_t Memory::read_word(uint16_t addr){
@@ -139,165 +214,271 @@ uint16_t Memory::read_word(uint16_t addr){
 
 }
 
-void Memory::write_byte(uint16_t addr, uint8_t data){
+//Page 0 for the processor port, and the I/O area with CHAR_mode == IO
+void Memory::write_io(uint16_t addr, uint8_t data){
 
-  	uint16_t page = (addr & 0xff00) >> 8;
+	uint8_t page = addr >> 8;
 
-  	//Zero Page
-  	if(page == 0){
+	//Same value back to zero page, nothing to do (this includes the processor port)
+	if(page == 0 and ram(addr) == data)
+		return;
 
-  		if(addr == MEMORY_LAYOUT_ADDR){
-  			bankSwitch(data);
-  		} else if(addr == 0xCC){
-  			//cout<<"scrivo blanking "<<hex<<unsigned(data)<<endl;
-  			//raise(SIGPIPE);
-  		} 
+	dirty_pages[page >> 6] |= 1ULL << (page & 63);
+	write_count++;
 
-  	} else if(addr >= VIC_START and addr <= VIC_END){
-		if(CHAR_mode == IO){		//VIC
-			vic->write_register(addr,data);
-			return;
-		} 
-	} else if(addr >= CIA1_START and addr <= CIA1_END){
-		cia1->write_register(addr,data);
+	if(addr == MEMORY_LAYOUT_ADDR){
+		bankSwitch(data);
 		return;
-	
-	} else if(addr >= CIA2_START and addr <= CIA2_END){
-		cia2->write_register(addr,data);
+	}
+
+	if(page == 0){
+		video_write(addr);
+		writable(0)[addr] = data;
 		return;
-	
-	} else if(addr >= COLOR_RAM_START and addr <= COLOR_RAM_END){
-		if(CHAR_mode == IO){
-			color_ram[addr - COLOR_RAM_START] = data;
-			return;
-		}
 	}
 
-	memory[addr] = data;
+	const io_handler &handler = io_handlers[IO_PAGE(addr)];
+	handler.write(handler.device, addr, data);
 
 }
 
-uint8_t Memory::VIC_read_byte(uint16_t addr){
-
+//Into the ROM images like the maps, RAM pages are found through the pages of the machine
+void Memory::build_vic_views(){
 
-	uint8_t VICBank = cia2->getVICBank();
+	memset(roms->vic_roms, 0, sizeof(roms->vic_roms));
 
-	addr += 0x4000 * VICBank;
-
-	//cout<<"VIC READ "<<hex<<unsigned(addr)<<endl;
-
-
-	if(VICBank == 0 and addr >= 0x1000 and addr <= 0x1FFF){
-		//Charset mirroring
-		return charset[addr-0x1000];
-
-	} else if(VICBank == 2 and addr >= 0x9000 and addr <= 0x9FFF){
-
-		return charset[addr-0x9000];
-
-	} else {
-		return memory[addr];
+	//Charset mirroring
+	for(int page = 0; page < 16; page++){
+		roms->vic_roms[0][(0x1000 >> 8) + page] = charset + page * 256;
+		roms->vic_roms[2][(0x1000 >> 8) + page] = charset + page * 256;
 	}
 
 }
 
-void Memory::bankSwitch(uint8_t value){
-  
+void Memory::bank_modes(uint8_t value, bankMode &loram, bankMode &hiram, bankMode &charen){
+
 	bool loram_en  = ((value & LORAM_MASK) != 0);
 	bool hiram_en = ((value & HIRAM_MASK) != 0);
 	bool char_en = ((value & CHAREN_MASK) != 0);
 
 	//Set everything to RAM as default
-	HIRAM_mode = RAM;
-	LORAM_mode = RAM;
-	CHAR_mode = RAM;
+	hiram = RAM;
+	loram = RAM;
+	charen = RAM;
 
 	//Kernal
 	if(hiram_en){
-		HIRAM_mode = ROM;
+		hiram = ROM;
 	}
 
 	//Basic
 	if(loram_en && hiram_en)
-		LORAM_mode = ROM;
+		loram = ROM;
 
 	//Char I/O
 	if(char_en && (loram_en || hiram_en))
-		CHAR_mode = IO;
+		charen = IO;
 	else if(char_en && !loram_en && !hiram_en)
-		CHAR_mode = RAM;
+		charen = RAM;
 	else 
-		CHAR_mode = ROM;
-	
-	memory[MEMORY_LAYOUT_ADDR] = value;
+		charen = ROM;
 
 }
 
-void Memory::load_kernal_and_basic(const string& filename){
+//Into the ROM images, so only a machine with ROMs of its own builds them
+void Memory::build_maps(){
 
-	streampos size;
-	uint8_t* rom = readBinFile(filename,size);
+	for(int value = 0; value < MEMORY_MAPS; value++){
 
-	//FIRST 8K are basic
-	memcpy(basic, rom, eightK);
-	memcpy(kernal, rom+eightK, eightK);
+		memory_map &m = roms->maps[value];
 
-	delete[] rom;
+		bankMode loram, hiram, charen;
+		bank_modes(value, loram, hiram, charen);
+
+		memset(m.read, RAM, sizeof(m.read));
+		memset(m.write, RAM, sizeof(m.write));
+		memset(m.rom, 0, sizeof(m.rom));
+
+		if(loram == ROM)
+			for(int page = 0; page < 32; page++){
+				m.read[(BASIC_START >> 8) + page] = ROM;
+				m.rom[(BASIC_START >> 8) + page] = basic + page * 256;
+			}
+
+		if(hiram == ROM)
+			for(int page = 0; page < 32; page++){
+				m.read[(KERNAL_START >> 8) + page] = ROM;
+				m.rom[(KERNAL_START >> 8) + page] = kernal + page * 256;
+			}
+
+		for(int page = 0; page < 16; page++){
+
+			if(charen == ROM){
+				m.read[(IO_START >> 8) + page] = ROM;
+				m.rom[(IO_START >> 8) + page] = charset + page * 256;
+
+			} else if(charen == IO)
+				m.read[(IO_START >> 8) + page] = m.write[(IO_START >> 8) + page] = IO;
+		}
+
+		//The processor port
+		m.write[0] = IO;
+	}
 
 }
 
-void Memory::load_charset(const string& filename){
+void Memory::bankSwitch(uint8_t value){
+
+	bank_modes(value, LORAM_mode, HIRAM_mode, CHAR_mode);
 
-	streampos size;
+	map = &roms->maps[value & MEMORY_MAP_MASK];
 
-	uint8_t* rom = readBinFile(filename,size);
+	writable(0)[MEMORY_LAYOUT_ADDR] = value;
+
+	update_code_slots();
 
-	memcpy(charset, rom, fourK);
-	
-	delete[] rom;
 }
 
-void Memory::load_custom_memory(const string& filename, uint16_t offset) {
+void Memory::update_code_slots(){
+
+	for(int page = 0; page < 256; page++)
+		code_slot[page] = page;
 
-	streampos size;
-	uint8_t* buffer = readBinFile(filename,size);
-	memcpy(memory+offset, buffer, size);
-	delete[] buffer;
+	if(LORAM_mode == ROM)
+		for(int page = 0; page < 32; page++)
+			code_slot[(BASIC_START >> 8) + page] = CODE_SLOT_BASIC + page;
+
+	if(HIRAM_mode == ROM)
+		for(int page = 0; page < 32; page++)
+			code_slot[(KERNAL_START >> 8) + page] = CODE_SLOT_KERNAL + page;
+
+	if(CHAR_mode != RAM)
+		for(int page = IO_START >> 8; page <= (IO_END >> 8); page++)
+			code_slot[page] = NO_CODE_SLOT;
 
 }
 
-void Memory::loadPrg(const string& filename) {
+void Memory::markDirty(uint16_t addr, uint32_t size){
+
+	for(uint32_t page = addr >> 8; page <= ((addr + size - 1) >> 8) and page < 256; page++)
+		dirty_pages[page >> 6] |= 1ULL << (page & 63);
+
+	for(uint32_t block = addr >> VIDEO_BLOCK_SHIFT; block <= ((addr + size - 1) >> VIDEO_BLOCK_SHIFT) and block < (sixtyfourK >> VIDEO_BLOCK_SHIFT); block++)
+		written.ram[block >> 6] |= 1ULL << (block & 63);
+
+}
+
+bool Memory::load_kernal_and_basic(const string& filename){
+
+	MappedFile *file = new MappedFile();
+
+	if(!file->open(filename) or file->size() < sixteenK){
+		delete file;
+		return false;
+	}
+
+	//FIRST 8K are basic
+	basic = roms->basic = file->data();
+	kernal = roms->kernal = file->data() + eightK;
+
+	delete roms->kernal_basic_file;
+	roms->kernal_basic_file = file;
+
+	build_maps();
+
+	return true;
+
+}
+
+bool Memory::load_charset(const string& filename){
+
+	MappedFile *file = new MappedFile();
 
-	streampos size;
-	uint8_t* buffer = readBinFile(filename,size);
+	if(!file->open(filename) or file->size() < fourK){
+		delete file;
+		return false;
+	}
+
+	charset = roms->charset = file->data();
 
-	uint16_t addr = buffer[1] << 8 | buffer[0];
+	delete roms->charset_file;
+	roms->charset_file = file;
 
-	size -= 2;
+	build_maps();
+	build_vic_views();
 
-	memcpy(memory+addr, buffer+2, size);
+	//Text on screen changes with the glyphs
+	memset(&written,0xFF,sizeof(written));
 
-	delete[] buffer;
+	return true;
 
 }
 
-void Memory::setVIC(VIC* vic){
-	this->vic = vic;
+bool Memory::load_custom_memory(const string& filename, uint16_t offset) {
+
+	MappedFile file;
+
+	if(!file.open(filename))
+		return false;
+
+	write_ram(offset, file.data(), file.size());
+
+	return true;
+
 }
 
-void Memory::setCIA1(CIA1* cia1){
-	this->cia1 = cia1;
+bool Memory::loadPrg(const string& filename) {
+
+	MappedFile file;
+
+	if(!file.open(filename) or file.size() < 2)
+		return false;
+
+	const uint8_t *data = file.data();
+
+	uint16_t addr = data[1] << 8 | data[0];
+
+	write_ram(addr, data + 2, file.size() - 2);
+
+	return true;
+
 }
 
-void Memory::setCIA2(CIA2* cia2){
-	this->cia2 = cia2;
+const size_t Memory::snapshot_size = sixtyfourK + 1000;
+
+void Memory::save(Snapshot &snapshot){
+
+	for(int page = 0; page < 256; page++)
+		snapshot.put(pages[page]->bytes, sizeof(pages[page]->bytes));
+
+	snapshot.put(color_ram, 1000);
+
 }
 
-uint8_t* Memory::getMemPointer(){
-	return memory;
+void Memory::restore(Snapshot &snapshot){
+
+	//Only the pages that differ are written, the others stay shared with the forks
+	for(int page = 0; page < 256; page++){
+
+		uint8_t bytes[256];
+		snapshot.get(bytes, sizeof(bytes));
+
+		if(memcmp(bytes, pages[page]->bytes, sizeof(bytes)) != 0)
+			memcpy(writable(page), bytes, sizeof(bytes));
+	}
+
+	snapshot.get(color_ram, 1000);
+
+	bankSwitch(ram(MEMORY_LAYOUT_ADDR));
+
+	//Whatever the CPU decoded or the VIC drew is stale
+	memset(dirty_pages,0xFF,sizeof(dirty_pages));
+	memset(&written,0xFF,sizeof(written));
+	write_count++;
+
 }
 
-uint8_t* Memory::getKerPointer(){
+const uint8_t* Memory::getKerPointer(){
 	return kernal;
 }
 
@@ -305,3 +486,13 @@ uint8_t* Memory::getColorMemoryPtr(){
 	return color_ram;
 }
 
+void Memory::takeVideoWrites(video_writes &writes){
+
+	for(int i = 0; i < (sixtyfourK >> VIDEO_BLOCK_SHIFT >> 6); i++)
+		writes.ram[i] |= written.ram[i];
+
+	writes.color |= written.color;
+
+	memset(&written,0,sizeof(written));
+
+}
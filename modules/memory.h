@@ -6,16 +6,74 @@ class Memory;
 #include "vic.h"
 #include "cia1.h"
 #include "cia2.h"
+#include "snapshot.h"
+#include "mapped_file.h"
+
+#include <atomic>
 
 #define MEMORY_LAYOUT_ADDR 0x1
 #define LORAM_MASK 0x1
 #define HIRAM_MASK 0x2
 #define CHAREN_MASK 0x4
 
+//One memory map for each setting of the three processor port bits
+#define MEMORY_MAPS 8
+#define MEMORY_MAP_MASK (LORAM_MASK | HIRAM_MASK | CHAREN_MASK)
+
 #define VIDEO_MEM_START 
 
 enum bankMode {RAM,ROM,IO,CARTRIDGE};
 
+//A device's registers, reached through plain function pointers so Memory doesn't link its code
+struct io_handler{
+	void *device;
+	uint8_t (*read)(void*, uint16_t);
+	void (*write)(void*, uint16_t, uint8_t);
+};
+
+//256 bytes of RAM, shared by a machine and its forks until one of them writes to it
+struct ram_page{
+	uint8_t bytes[256];
+	atomic<uint32_t> refs;
+};
+
+//How each page is read and written for one setting of the processor port. RAM pages are
+//found through the pages of the machine, so the same maps serve a machine and all its forks
+struct memory_map{
+	uint8_t read[256];			//bankMode: RAM, ROM or IO
+	uint8_t write[256];			//RAM or IO
+	const uint8_t *rom[256];	//Where the ROM pages are
+};
+
+//The VIC sees 16K at a time, RAM but for the charset ROM at $1000 of banks 0 and 2
+#define VIC_BANKS 4
+#define VIC_BANK_PAGES 64
+
+//Stock ROMs, compiled in by embed_rom from roms/251913-01.bin and roms/901225-01.bin
+extern const uint8_t kernal_basic_rom[];
+extern const size_t kernal_basic_rom_size;
+extern const uint8_t charset_rom[];
+extern const size_t charset_rom_size;
+
+//Never written, shared by a machine and all its forks. The stock ROMs or the
+//mappings of the files replacing them, and the maps built on them
+struct rom_images{
+	const uint8_t *basic;
+	const uint8_t *kernal;
+	const uint8_t *charset;
+	MappedFile *kernal_basic_file = nullptr;
+	MappedFile *charset_file = nullptr;
+	memory_map maps[MEMORY_MAPS];
+	const uint8_t *vic_roms[VIC_BANKS][VIC_BANK_PAGES];	//nullptr where the VIC sees RAM
+	atomic<uint32_t> refs;
+
+	~rom_images(){ delete kernal_basic_file; delete charset_file; }
+};
+
+//$D000 is 16 pages aligned, the low bits of the page number index the handlers
+#define IO_PAGES ((IO_END - IO_START + 1) >> 8)
+#define IO_PAGE(addr) (((addr) >> 8) & (IO_PAGES - 1))
+
 class Memory{
 
 	public:
@@ -23,29 +81,148 @@ class Memory{
 		Memory();
 		~Memory();
 
-		uint8_t read_byte(uint16_t);
+		//Fork: RAM pages and ROMs are shared with the parent, copied only on the first write
+		//by either one. Devices are not connected. Call it from the thread running the parent
+		Memory(const Memory&);
+
+		//RAM and ROMs as the map of the current bank mode says, devices through read_io
+		uint8_t read_byte(uint16_t addr){
+
+			uint8_t page = addr >> 8;
+			uint8_t mode = map->read[page];
+
+			if(mode == RAM)
+				return pages[page]->bytes[addr & 0xFF];
+
+			if(mode == ROM)
+				return map->rom[page][addr & 0xFF];
+
+			return read_io(addr);
+		}
+
 		uint16_t read_word(uint16_t);
 
-		void write_byte(uint16_t,uint8_t);
+		//Page 0 and 1 are always RAM, only a write to the processor port at $01 switches banks
+		uint8_t read_zero_page(uint8_t addr){ return pages[0]->bytes[addr]; }
+
+		uint16_t read_zero_page_word(uint8_t addr){
+			return pages[0]->bytes[addr] | (pages[0]->bytes[(uint8_t)(addr + 1)] << 8);
+		}
+
+		void write_zero_page(uint8_t addr, uint8_t data){
+
+			if(pages[0]->bytes[addr] == data)
+				return;
+
+			dirty_pages[0] |= 1ULL << (ZERO_START >> 8);
+			write_count++;
+			video_write(addr);
+
+			if(addr == MEMORY_LAYOUT_ADDR)
+				bankSwitch(data);
+			else
+				writable(0)[addr] = data;
+		}
+
+		uint8_t read_stack(uint8_t sp){ return pages[STACK_START >> 8]->bytes[sp]; }
+
+		void write_stack(uint8_t sp, uint8_t data){
+
+			if(pages[STACK_START >> 8]->bytes[sp] == data)
+				return;
+
+			dirty_pages[0] |= 1ULL << (STACK_START >> 8);
+			write_count++;
+			video_write(STACK_START + sp);
+			writable(STACK_START >> 8)[sp] = data;
+		}
+
+		//RAM, also under the ROMs, is written here. Devices and the processor port go through write_io
+		void write_byte(uint16_t addr, uint8_t data){
+
+			uint8_t page = addr >> 8;
+
+			if(map->write[page] == IO){
+				write_io(addr, data);
+				return;
+			}
+
+			if(pages[page]->bytes[addr & 0xFF] == data)
+				return;
+
+			dirty_pages[page >> 6] |= 1ULL << (page & 63);
+			write_count++;
+			video_write(addr);
+			writable(page)[addr & 0xFF] = data;
+		}
+
+		//addr is in the 16K bank chosen through setVICBank
+		uint8_t VIC_read_byte(uint16_t addr){
+
+			uint8_t page = (addr >> 8) & (VIC_BANK_PAGES - 1);
+			const uint8_t *rom = vic_rom[page];
 
-		uint8_t VIC_read_byte(uint16_t);
+			if(rom)
+				return rom[addr & 0xFF];
 
-		void load_kernal_and_basic(const string&);
-		void load_charset(const string&);
-		void load_custom_memory(const string&,uint16_t);
-		void loadPrg(const string&);
+			return pages[vic_bank_start + page]->bytes[addr & 0xFF];
+		}
 
-		void setVIC(VIC*);
-		void setCIA1(CIA1*);
-		void setCIA2(CIA2*);
+		//Called by CIA2 when $DD00 selects a bank
+		void setVICBank(uint8_t bank){
+			vic_bank_start = (bank & (VIC_BANKS - 1)) * VIC_BANK_PAGES;
+			vic_rom = roms->vic_roms[bank & (VIC_BANKS - 1)];
+		}
+
+		//Replace the stock ROMs, before running or forking. False if the file is missing or too short
+		bool load_kernal_and_basic(const string&);
+		bool load_charset(const string&);
+
+		//Straight from the mapped file into RAM. False if it is missing or too short
+		bool load_custom_memory(const string&,uint16_t);
+		bool loadPrg(const string&);
+
+		//Inline, so Memory alone links without the devices
+		void setVIC(VIC *vic){ this->vic = vic; attachIO(VIC_START, VIC_END, vic); }
+		void setCIA1(CIA1 *cia1){ this->cia1 = cia1; attachIO(CIA1_START, CIA1_END, cia1); }
+		void setCIA2(CIA2 *cia2){ this->cia2 = cia2; attachIO(CIA2_START, CIA2_END, cia2); }
+
+		//Pages of the I/O area from start to end go to the device, any class with
+		//read_register(uint16_t) and write_register(uint16_t,uint8_t). Unattached pages
+		//read 0xFF and write the RAM below
+		template<class Device> void attachIO(uint16_t start, uint16_t end, Device *device){
+
+			io_handler handler = { device, &io_read<Device>, &io_write<Device> };
+
+			for(int page = start >> 8; page <= (end >> 8); page++)
+				io_handlers[IO_PAGE(page << 8)] = handler;
+		}
 
 		void bankSwitch(uint8_t);
 
+		//RAM and color RAM, the banks follow the processor port
+		void save(Snapshot&);
+		void restore(Snapshot&);
+		static const size_t snapshot_size;
+
 		uint8_t* getColorMemoryPtr();
 
+		//Written since the last takeVideoWrites, which ORs them in and starts over
+		const video_writes& videoWrites(){ return written; }
+		void takeVideoWrites(video_writes&);
+
+		//Where the CPU can cache decoded code for a page, NO_CODE_SLOT for I/O and charset
+		int16_t codeSlot(uint8_t page){ return code_slot[page]; }
+
+		//Pages written since the CPU last decoded them
+		bool pageDirty(uint8_t page){ return (dirty_pages[page >> 6] >> (page & 63)) & 1; }
+		void cleanPage(uint8_t page){ dirty_pages[page >> 6] &= ~(1ULL << (page & 63)); }
+
+		//Bumped by every write that changes RAM or reaches a device
+		uint32_t writeCount(){ return write_count; }
+
 		//Debug
-		uint8_t* getMemPointer();
-		uint8_t* getKerPointer();
+		const uint8_t* getKerPointer();
 		void dump_memory(uint16_t,uint16_t);
 		void dump_color_memory();
 
@@ -55,15 +232,80 @@ class Memory{
 		CIA1 	*cia1 = nullptr;
 		CIA2 	*cia2 = nullptr;
 
-		uint8_t *memory;
+		ram_page *pages[256];
 		uint8_t *color_ram;
 
-		uint8_t *basic;
-		uint8_t *kernal;
-		uint8_t *charset;
+		rom_images *roms;
+		const uint8_t *basic;
+		const uint8_t *kernal;
+		const uint8_t *charset;
 
 		bankMode LORAM_mode;
 		bankMode HIRAM_mode;
 		bankMode CHAR_mode;
 
+		//One of roms->maps, built once for every bank mode. bankSwitch only picks one
+		const memory_map *map;
+
+		static void bank_modes(uint8_t, bankMode&, bankMode&, bankMode&);
+		void build_maps();
+
+		//First page of the VIC bank and its charset pages, one of roms->vic_roms built once like the maps
+		uint8_t vic_bank_start;
+		const uint8_t *const *vic_rom;
+
+		void build_vic_views();
+
+		int16_t code_slot[256];
+		uint64_t dirty_pages[4];
+		uint32_t write_count = 0;
+
+		video_writes written;
+
+		void video_write(uint16_t addr){
+			written.ram[addr >> 12] |= 1ULL << ((addr >> VIDEO_BLOCK_SHIFT) & 63);
+		}
+
+		//One for each page of the I/O area
+		io_handler io_handlers[IO_PAGES];
+
+		void detach_io();
+
+		template<class Device> static uint8_t io_read(void *device, uint16_t addr){
+			return ((Device*)device)->read_register(addr);
+		}
+
+		template<class Device> static void io_write(void *device, uint16_t addr, uint8_t data){
+			((Device*)device)->write_register(addr, data);
+		}
+
+		static uint8_t open_io_read(void*, uint16_t);
+		static void open_io_write(void*, uint16_t, uint8_t);
+		static uint8_t color_ram_read(void*, uint16_t);
+		static void color_ram_write(void*, uint16_t, uint8_t);
+
+		uint8_t read_io(uint16_t addr){
+			const io_handler &handler = io_handlers[IO_PAGE(addr)];
+			return handler.read(handler.device, addr);
+		}
+
+		void write_io(uint16_t, uint8_t);
+
+		uint8_t ram(uint16_t addr){ return pages[addr >> 8]->bytes[addr & 0xFF]; }
+
+		//Bytes of a page about to be written, copied first while someone else shares it
+		uint8_t* writable(uint8_t page){
+
+			if(pages[page]->refs.load(memory_order_acquire) != 1)
+				unshare(page);
+
+			return pages[page]->bytes;
+		}
+
+		void unshare(uint8_t);
+		void write_ram(uint16_t, const uint8_t*, uint32_t);
+
+		void markDirty(uint16_t, uint32_t);
+		void update_code_slots();
+
 };
\ No newline at end of file
@@ -0,0 +1,10 @@
+#include "opcodes.h"
+
+//Opcode table, generated from OPCODE_LIST
+#define OPCODE_INFO(code, mnemonic, mode, cycles, length) {#mnemonic, mode, cycles, length},
+
+const opcode_info opcode_table[256] = {
+	OPCODE_LIST(OPCODE_INFO)
+};
+
+#undef OPCODE_INFO
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstdint>
+
+enum addressing_mode
+{
+	IMP,ACC,IMM,ZPG,ZPX,ZPY,ABS,ABX,ABY,IND,IZX,IZY,REL
+};
+
+struct opcode_info{
+	const char *mnemonic;
+	addressing_mode mode;
+	uint8_t cycles;
+	uint8_t length;
+};
+
+extern const opcode_info opcode_table[256];
+
+//Opcode table of the 6502
+//X(opcode in hex, mnemonic, addressing mode, base cycles, length in bytes)
+//Illegal opcodes are listed as ILL so every one of the 256 entries is present
+
+#define OPCODE_LIST(X) \
+	X(00, BRK, IMP, 7, 1) \
+	X(01, ORA, IZX, 6, 2) \
+	X(02, ILL, IMP, 0, 1) \
+	X(03, ILL, IMP, 0, 1) \
+	X(04, ILL, IMP, 0, 1) \
+	X(05, ORA, ZPG, 3, 2) \
+	X(06, ASL, ZPG, 5, 2) \
+	X(07, ILL, IMP, 0, 1) \
+	X(08, PHP, IMP, 3, 1) \
+	X(09, ORA, IMM, 2, 2) \
+	X(0A, ASL, ACC, 2, 1) \
+	X(0B, ILL, IMP, 0, 1) \
+	X(0C, ILL, IMP, 0, 1) \
+	X(0D, ORA, ABS, 4, 3) \
+	X(0E, ASL, ABS, 6, 3) \
+	X(0F, ILL, IMP, 0, 1) \
+	X(10, BPL, REL, 2, 2) \
+	X(11, ORA, IZY, 5, 2) \
+	X(12, ILL, IMP, 0, 1) \
+	X(13, ILL, IMP, 0, 1) \
+	X(14, ILL, IMP, 0, 1) \
+	X(15, ORA, ZPX, 4, 2) \
+	X(16, ASL, ZPX, 6, 2) \
+	X(17, ILL, IMP, 0, 1) \
+	X(18, CLC, IMP, 2, 1) \
+	X(19, ORA, ABY, 4, 3) \
+	X(1A, ILL, IMP, 0, 1) \
+	X(1B, ILL, IMP, 0, 1) \
+	X(1C, ILL, IMP, 0, 1) \
+	X(1D, ORA, ABX, 4, 3) \
+	X(1E, ASL, ABX, 7, 3) \
+	X(1F, ILL, IMP, 0, 1) \
+	X(20, JSR, ABS, 6, 3) \
+	X(21, AND, IZX, 6, 2) \
+	X(22, ILL, IMP, 0, 1) \
+	X(23, ILL, IMP, 0, 1) \
+	X(24, BIT, ZPG, 3, 2) \
+	X(25, AND, ZPG, 3, 2) \
+	X(26, ROL, ZPG, 5, 2) \
+	X(27, ILL, IMP, 0, 1) \
+	X(28, PLP, IMP, 4, 1) \
+	X(29, AND, IMM, 2, 2) \
+	X(2A, ROL, ACC, 2, 1) \
+	X(2B, ILL, IMP, 0, 1) \
+	X(2C, BIT, ABS, 4, 3) \
+	X(2D, AND, ABS, 4, 3) \
+	X(2E, ROL, ABS, 6, 3) \
+	X(2F, ILL, IMP, 0, 1) \
+	X(30, BMI, REL, 2, 2) \
+	X(31, AND, IZY, 5, 2) \
+	X(32, ILL, IMP, 0, 1) \
+	X(33, ILL, IMP, 0, 1) \
+	X(34, ILL, IMP, 0, 1) \
+	X(35, AND, ZPX, 4, 2) \
+	X(36, ROL, ZPX, 6, 2) \
+	X(37, ILL, IMP, 0, 1) \
+	X(38, SEC, IMP, 2, 1) \
+	X(39, AND, ABY, 4, 3) \
+	X(3A, ILL, IMP, 0, 1) \
+	X(3B, ILL, IMP, 0, 1) \
+	X(3C, ILL, IMP, 0, 1) \
+	X(3D, AND, ABX, 4, 3) \
+	X(3E, ROL, ABX, 7, 3) \
+	X(3F, ILL, IMP, 0, 1) \
+	X(40, RTI, IMP, 6, 1) \
+	X(41, EOR, IZX, 6, 2) \
+	X(42, ILL, IMP, 0, 1) \
+	X(43, ILL, IMP, 0, 1) \
+	X(44, ILL, IMP, 0, 1) \
+	X(45, EOR, ZPG, 3, 2) \
+	X(46, LSR, ZPG, 5, 2) \
+	X(47, ILL, IMP, 0, 1) \
+	X(48, PHA, IMP, 3, 1) \
+	X(49, EOR, IMM, 2, 2) \
+	X(4A, LSR, ACC, 2, 1) \
+	X(4B, ILL, IMP, 0, 1) \
+	X(4C, JMP, ABS, 3, 3) \
+	X(4D, EOR, ABS, 4, 3) \
+	X(4E, LSR, ABS, 6, 3) \
+	X(4F, ILL, IMP, 0, 1) \
+	X(50, BVC, REL, 2, 2) \
+	X(51, EOR, IZY, 5, 2) \
+	X(52, ILL, IMP, 0, 1) \
+	X(53, ILL, IMP, 0, 1) \
+	X(54, ILL, IMP, 0, 1) \
+	X(55, EOR, ZPX, 4, 2) \
+	X(56, LSR, ZPX, 6, 2) \
+	X(57, ILL, IMP, 0, 1) \
+	X(58, CLI, IMP, 2, 1) \
+	X(59, EOR, ABY, 4, 3) \
+	X(5A, ILL, IMP, 0, 1) \
+	X(5B, ILL, IMP, 0, 1) \
+	X(5C, ILL, IMP, 0, 1) \
+	X(5D, EOR, ABX, 4, 3) \
+	X(5E, LSR, ABX, 7, 3) \
+	X(5F, ILL, IMP, 0, 1) \
+	X(60, RTS, IMP, 6, 1) \
+	X(61, ADC, IZX, 6, 2) \
+	X(62, ILL, IMP, 0, 1) \
+	X(63, ILL, IMP, 0, 1) \
+	X(64, ILL, IMP, 0, 1) \
+	X(65, ADC, ZPG, 3, 2) \
+	X(66, ROR, ZPG, 5, 2) \
+	X(67, ILL, IMP, 0, 1) \
+	X(68, PLA, IMP, 4, 1) \
+	X(69, ADC, IMM, 2, 2) \
+	X(6A, ROR, ACC, 2, 1) \
+	X(6B, ILL, IMP, 0, 1) \
+	X(6C, JMP, IND, 5, 3) \
+	X(6D, ADC, ABS, 4, 3) \
+	X(6E, ROR, ABS, 6, 3) \
+	X(6F, ILL, IMP, 0, 1) \
+	X(70, BVS, REL, 2, 2) \
+	X(71, ADC, IZY, 5, 2) \
+	X(72, ILL, IMP, 0, 1) \
+	X(73, ILL, IMP, 0, 1) \
+	X(74, ILL, IMP, 0, 1) \
+	X(75, ADC, ZPX, 4, 2) \
+	X(76, ROR, ZPX, 6, 2) \
+	X(77, ILL, IMP, 0, 1) \
+	X(78, SEI, IMP, 2, 1) \
+	X(79, ADC, ABY, 4, 3) \
+	X(7A, ILL, IMP, 0, 1) \
+	X(7B, ILL, IMP, 0, 1) \
+	X(7C, ILL, IMP, 0, 1) \
+	X(7D, ADC, ABX, 4, 3) \
+	X(7E, ROR, ABX, 7, 3) \
+	X(7F, ILL, IMP, 0, 1) \
+	X(80, ILL, IMP, 0, 1) \
+	X(81, STA, IZX, 6, 2) \
+	X(82, ILL, IMP, 0, 1) \
+	X(83, ILL, IMP, 0, 1) \
+	X(84, STY, ZPG, 3, 2) \
+	X(85, STA, ZPG, 3, 2) \
+	X(86, STX, ZPG, 3, 2) \
+	X(87, ILL, IMP, 0, 1) \
+	X(88, DEY, IMP, 2, 1) \
+	X(89, ILL, IMP, 0, 1) \
+	X(8A, TXA, IMP, 2, 1) \
+	X(8B, ILL, IMP, 0, 1) \
+	X(8C, STY, ABS, 4, 3) \
+	X(8D, STA, ABS, 4, 3) \
+	X(8E, STX, ABS, 4, 3) \
+	X(8F, ILL, IMP, 0, 1) \
+	X(90, BCC, REL, 2, 2) \
+	X(91, STA, IZY, 6, 2) \
+	X(92, ILL, IMP, 0, 1) \
+	X(93, ILL, IMP, 0, 1) \
+	X(94, STY, ZPX, 4, 2) \
+	X(95, STA, ZPX, 4, 2) \
+	X(96, STX, ZPY, 4, 2) \
+	X(97, ILL, IMP, 0, 1) \
+	X(98, TYA, IMP, 2, 1) \
+	X(99, STA, ABY, 5, 3) \
+	X(9A, TXS, IMP, 2, 1) \
+	X(9B, ILL, IMP, 0, 1) \
+	X(9C, ILL, IMP, 0, 1) \
+	X(9D, STA, ABX, 5, 3) \
+	X(9E, ILL, IMP, 0, 1) \
+	X(9F, ILL, IMP, 0, 1) \
+	X(A0, LDY, IMM, 2, 2) \
+	X(A1, LDA, IZX, 6, 2) \
+	X(A2, LDX, IMM, 2, 2) \
+	X(A3, ILL, IMP, 0, 1) \
+	X(A4, LDY, ZPG, 3, 2) \
+	X(A5, LDA, ZPG, 3, 2) \
+	X(A6, LDX, ZPG, 3, 2) \
+	X(A7, ILL, IMP, 0, 1) \
+	X(A8, TAY, IMP, 2, 1) \
+	X(A9, LDA, IMM, 2, 2) \
+	X(AA, TAX, IMP, 2, 1) \
+	X(AB, ILL, IMP, 0, 1) \
+	X(AC, LDY, ABS, 4, 3) \
+	X(AD, LDA, ABS, 4, 3) \
+	X(AE, LDX, ABS, 4, 3) \
+	X(AF, ILL, IMP, 0, 1) \
+	X(B0, BCS, REL, 2, 2) \
+	X(B1, LDA, IZY, 5, 2) \
+	X(B2, ILL, IMP, 0, 1) \
+	X(B3, ILL, IMP, 0, 1) \
+	X(B4, LDY, ZPX, 4, 2) \
+	X(B5, LDA, ZPX, 4, 2) \
+	X(B6, LDX, ZPY, 4, 2) \
+	X(B7, ILL, IMP, 0, 1) \
+	X(B8, CLV, IMP, 2, 1) \
+	X(B9, LDA, ABY, 4, 3) \
+	X(BA, TSX, IMP, 2, 1) \
+	X(BB, ILL, IMP, 0, 1) \
+	X(BC, LDY, ABX, 4, 3) \
+	X(BD, LDA, ABX, 4, 3) \
+	X(BE, LDX, ABY, 4, 3) \
+	X(BF, ILL, IMP, 0, 1) \
+	X(C0, CPY, IMM, 2, 2) \
+	X(C1, CMP, IZX, 6, 2) \
+	X(C2, ILL, IMP, 0, 1) \
+	X(C3, ILL, IMP, 0, 1) \
+	X(C4, CPY, ZPG, 3, 2) \
+	X(C5, CMP, ZPG, 3, 2) \
+	X(C6, DEC, ZPG, 5, 2) \
+	X(C7, ILL, IMP, 0, 1) \
+	X(C8, INY, IMP, 2, 1) \
+	X(C9, CMP, IMM, 2, 2) \
+	X(CA, DEX, IMP, 2, 1) \
+	X(CB, ILL, IMP, 0, 1) \
+	X(CC, CPY, ABS, 4, 3) \
+	X(CD, CMP, ABS, 4, 3) \
+	X(CE, DEC, ABS, 6, 3) \
+	X(CF, ILL, IMP, 0, 1) \
+	X(D0, BNE, REL, 2, 2) \
+	X(D1, CMP, IZY, 5, 2) \
+	X(D2, ILL, IMP, 0, 1) \
+	X(D3, ILL, IMP, 0, 1) \
+	X(D4, ILL, IMP, 0, 1) \
+	X(D5, CMP, ZPX, 4, 2) \
+	X(D6, DEC, ZPX, 6, 2) \
+	X(D7, ILL, IMP, 0, 1) \
+	X(D8, CLD, IMP, 2, 1) \
+	X(D9, CMP, ABY, 4, 3) \
+	X(DA, ILL, IMP, 0, 1) \
+	X(DB, ILL, IMP, 0, 1) \
+	X(DC, ILL, IMP, 0, 1) \
+	X(DD, CMP, ABX, 4, 3) \
+	X(DE, DEC, ABX, 7, 3) \
+	X(DF, ILL, IMP, 0, 1) \
+	X(E0, CPX, IMM, 2, 2) \
+	X(E1, SBC, IZX, 6, 2) \
+	X(E2, ILL, IMP, 0, 1) \
+	X(E3, ILL, IMP, 0, 1) \
+	X(E4, CPX, ZPG, 3, 2) \
+	X(E5, SBC, ZPG, 3, 2) \
+	X(E6, INC, ZPG, 5, 2) \
+	X(E7, ILL, IMP, 0, 1) \
+	X(E8, INX, IMP, 2, 1) \
+	X(E9, SBC, IMM, 2, 2) \
+	X(EA, NOP, IMP, 2, 1) \
+	X(EB, ILL, IMP, 0, 1) \
+	X(EC, CPX, ABS, 4, 3) \
+	X(ED, SBC, ABS, 4, 3) \
+	X(EE, INC, ABS, 6, 3) \
+	X(EF, ILL, IMP, 0, 1) \
+	X(F0, BEQ, REL, 2, 2) \
+	X(F1, SBC, IZY, 5, 2) \
+	X(F2, ILL, IMP, 0, 1) \
+	X(F3, ILL, IMP, 0, 1) \
+	X(F4, ILL, IMP, 0, 1) \
+	X(F5, SBC, ZPX, 4, 2) \
+	X(F6, INC, ZPX, 6, 2) \
+	X(F7, ILL, IMP, 0, 1) \
+	X(F8, SED, IMP, 2, 1) \
+	X(F9, SBC, ABY, 4, 3) \
+	X(FA, ILL, IMP, 0, 1) \
+	X(FB, ILL, IMP, 0, 1) \
+	X(FC, ILL, IMP, 0, 1) \
+	X(FD, SBC, ABX, 4, 3) \
+	X(FE, INC, ABX, 7, 3) \
+	X(FF, ILL, IMP, 0, 1)
+
@@ -0,0 +1,103 @@
+#include "profiler.h"
+#include "memory.h"
+
+#include <algorithm>
+#include <vector>
+#include <iomanip>
+#include <sstream>
+
+Profiler::Profiler(){
+
+	executions = new uint64_t[sixtyfourK];
+	spent = new uint64_t[sixtyfourK];
+
+	reset();
+
+}
+
+Profiler::~Profiler(){
+
+	delete[] executions;
+	delete[] spent;
+
+}
+
+void Profiler::reset(){
+
+	memset(executions,0,sixtyfourK * sizeof(uint64_t));
+	memset(spent,0,sixtyfourK * sizeof(uint64_t));
+
+}
+
+void Profiler::report(Memory *memory, unsigned n){
+
+	vector<uint16_t> hot;
+	uint64_t total_cycles = 0;
+	uint64_t total_executions = 0;
+
+	for(uint32_t pc = 0; pc < sixtyfourK; pc++){
+
+		if(spent[pc] == 0)
+			continue;
+
+		hot.push_back(pc);
+		total_cycles += spent[pc];
+		total_executions += executions[pc];
+	}
+
+	n = min<size_t>(n, hot.size());
+
+	partial_sort(hot.begin(), hot.begin() + n, hot.end(), [this](uint16_t a, uint16_t b){
+		return spent[a] > spent[b];
+	});
+
+	cout<<endl<<"Profile: "<<dec<<total_executions<<" instructions, "<<total_cycles<<" cycles"<<endl;
+	cout<<"  PC        executions          cycles       %  "<<endl;
+
+	for(unsigned i = 0; i < n; i++){
+
+		uint16_t pc = hot[i];
+
+		cout<<"  "<<hex<<setw(4)<<setfill('0')<<pc<<setfill(' ')<<dec;
+		cout<<setw(18)<<executions[pc]<<setw(16)<<spent[pc];
+		cout<<setw(8)<<fixed<<setprecision(2)<<(100.0 * spent[pc] / total_cycles)<<"  ";
+		cout<<disassemble(memory,pc)<<endl;
+	}
+
+	cout.unsetf(ios::fixed);
+
+}
+
+//One instruction in assembler syntax, code under I/O is not read to avoid side effects
+string disassemble(Memory *memory, uint16_t addr){
+
+	if(memory->codeSlot(addr >> 8) == NO_CODE_SLOT)
+		return "(I/O)";
+
+	const opcode_info &info = opcode_table[memory->read_byte(addr)];
+
+	uint8_t lo = memory->read_byte(addr + 1);
+	uint16_t word = lo | (memory->read_byte(addr + 2) << 8);
+
+	stringstream out;
+	out<<info.mnemonic<<hex<<setfill('0');
+
+	switch(info.mode){
+		case ACC:	out<<" A"; break;
+		case IMM:	out<<" #$"<<setw(2)<<unsigned(lo); break;
+		case ZPG:	out<<" $"<<setw(2)<<unsigned(lo); break;
+		case ZPX:	out<<" $"<<setw(2)<<unsigned(lo)<<",X"; break;
+		case ZPY:	out<<" $"<<setw(2)<<unsigned(lo)<<",Y"; break;
+		case ABS:	out<<" $"<<setw(4)<<word; break;
+		case ABX:	out<<" $"<<setw(4)<<word<<",X"; break;
+		case ABY:	out<<" $"<<setw(4)<<word<<",Y"; break;
+		case IND:	out<<" ($"<<setw(4)<<word<<")"; break;
+		case IZX:	out<<" ($"<<setw(2)<<unsigned(lo)<<",X)"; break;
+		case IZY:	out<<" ($"<<setw(2)<<unsigned(lo)<<"),Y"; break;
+		case REL:	out<<" $"<<setw(4)<<uint16_t(addr + 2 + int8_t(lo)); break;
+		default:	break;
+	}
+
+	return out.str();
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+class Profiler;
+class Memory;
+
+#include "library.h"
+#include "opcodes.h"
+
+#define PROFILE_TOP_N 20
+
+//Executions and cycles spent for every guest PC
+class Profiler{
+
+	public:
+		Profiler();
+		~Profiler();
+
+		void record(uint16_t pc, uint32_t cycles){
+			executions[pc]++;
+			spent[pc] += cycles;
+		}
+
+		//Cycles skipped by an idle loop go to its first instruction
+		void charge(uint16_t pc, uint32_t cycles){ spent[pc] += cycles; }
+
+		//Top n addresses by cycles, disassembled from the current memory map
+		void report(Memory*, unsigned);
+		void reset();
+
+	private:
+		uint64_t *executions;
+		uint64_t *spent;
+
+};
+
+string disassemble(Memory*, uint16_t);
@@ -0,0 +1,168 @@
+#include "rewind.h"
+
+//Shortest run of unchanged bytes worth ending a literal for
+#define MIN_ZERO_RUN 4
+
+static void put_varint(vector<uint8_t> &out, size_t value){
+
+	while(value >= 0x80){
+		out.push_back((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	out.push_back(value);
+
+}
+
+static size_t get_varint(const vector<uint8_t> &in, size_t &pos){
+
+	size_t value = 0;
+
+	for(int shift = 0; pos < in.size(); shift += 7){
+		uint8_t byte = in[pos++];
+		value |= (size_t)(byte & 0x7F) << shift;
+
+		if(!(byte & 0x80))
+			break;
+	}
+
+	return value;
+
+}
+
+Rewind::Rewind(Machine *machine, uint32_t frames, size_t budget){
+
+	this->machine = machine;
+	this->cpu = machine->getCPU();
+	this->budget = budget;
+
+	interval = (uint64_t)frames * FRAME_CYCLES;
+	next_capture = cpu->cycles_executed;
+	used = 0;
+
+}
+
+void Rewind::capture(){
+
+	Snapshot snapshot;
+	machine->save(snapshot);
+
+	const uint8_t *data = snapshot.data();
+
+	if(newest.size() == snapshot.size()){
+		deltas.emplace_back();
+		encode(newest.data(), data, newest.size(), deltas.back());
+		used += deltas.back().size();
+	} else {
+		//First one, or the layout changed and the history can't be replayed
+		deltas.clear();
+		used = 0;
+	}
+
+	newest.assign(data, data + snapshot.size());
+
+	while(used > budget and !deltas.empty()){
+		used -= deltas.front().size();
+		deltas.pop_front();
+	}
+
+	next_capture = cpu->cycles_executed + interval;
+
+}
+
+bool Rewind::back(double seconds){
+
+	if(newest.empty())
+		return false;
+
+	uint64_t steps = seconds * 1000 / FRAME_MS * FRAME_CYCLES / interval;
+
+	//Counted from the newest snapshot, which is up to an interval behind the machine
+	for(; steps > 0 and !deltas.empty(); steps--){
+		apply(deltas.back(), newest.data(), newest.size());
+		used -= deltas.back().size();
+		deltas.pop_back();
+	}
+
+	Snapshot snapshot(newest.data(), newest.size());
+
+	if(!machine->restore(snapshot))
+		return false;
+
+	next_capture = cpu->cycles_executed + interval;
+
+	return true;
+
+}
+
+double Rewind::seconds(){
+
+	return (double)deltas.size() * interval / FRAME_CYCLES * FRAME_MS / 1000;
+
+}
+
+size_t Rewind::memoryUsed(){
+
+	return used + newest.size();
+
+}
+
+//Alternating runs: a count of unchanged bytes, then a count of changed bytes and their XOR.
+//The unchanged bytes at the end are left out
+void Rewind::encode(const uint8_t *older, const uint8_t *newer, size_t size, vector<uint8_t> &out){
+
+	size_t i = 0;
+
+	while(true){
+
+		size_t start = i;
+
+		while(i < size and older[i] == newer[i])
+			i++;
+
+		if(i == size)
+			break;
+
+		size_t zeros = i - start;
+		size_t literal = i;
+
+		//A literal swallows unchanged runs too short to pay for their own counts
+		while(i < size){
+
+			size_t same = 0;
+
+			while(i + same < size and same < MIN_ZERO_RUN and older[i + same] == newer[i + same])
+				same++;
+
+			if(same == MIN_ZERO_RUN or i + same == size)
+				break;
+
+			i += same + 1;
+		}
+
+		put_varint(out, zeros);
+		put_varint(out, i - literal);
+
+		for(size_t j = literal; j < i; j++)
+			out.push_back(older[j] ^ newer[j]);
+	}
+
+	out.shrink_to_fit();
+
+}
+
+void Rewind::apply(const vector<uint8_t> &delta, uint8_t *data, size_t size){
+
+	size_t pos = 0;
+	size_t i = 0;
+
+	while(pos < delta.size()){
+
+		i += get_varint(delta, pos);
+		size_t literal = get_varint(delta, pos);
+
+		for(size_t j = 0; j < literal and i < size and pos < delta.size(); j++)
+			data[i++] ^= delta[pos++];
+	}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+class Rewind;
+
+#include "library.h"
+#include "machine.h"
+#include "snapshot.h"
+
+#include <deque>
+#include <vector>
+
+//A snapshot every 10 frames, 5 a second
+#define REWIND_INTERVAL_FRAMES 10
+
+//Deltas kept before the oldest ones are dropped
+#define REWIND_BUDGET (16 << 20)
+
+//How far back a press of the rewind hotkey goes
+#define REWIND_HOTKEY_SECONDS 5
+
+//History of machine states: the newest snapshot is kept whole, every older one as the
+//XOR with the one after it, run length encoded. Most of the state does not change between
+//two snapshots, so a delta is mostly one long run of zeros
+class Rewind{
+
+	public:
+		Rewind(Machine*, uint32_t = REWIND_INTERVAL_FRAMES, size_t = REWIND_BUDGET);
+
+		//Takes a snapshot when one is due, called after every Machine::step
+		void clock(){
+			if(cpu->cycles_executed >= next_capture)
+				capture();
+		}
+
+		//Restores the machine as it was that many emulated seconds ago, or as far back as
+		//the history goes. Newer snapshots are dropped, the run goes on from there.
+		//False if there is no history yet
+		bool back(double);
+
+		//Emulated seconds of history and the memory they take
+		double seconds();
+		size_t memoryUsed();
+
+	private:
+		Machine *machine;
+		CPU *cpu;
+
+		uint64_t interval;
+		uint64_t next_capture;
+
+		size_t budget;
+		size_t used;
+
+		vector<uint8_t> newest;
+
+		//deltas[i] turns snapshot i + 1 into snapshot i, the oldest comes first
+		deque<vector<uint8_t>> deltas;
+
+		void capture();
+
+		static void encode(const uint8_t*, const uint8_t*, size_t, vector<uint8_t>&);
+		static void apply(const vector<uint8_t>&, uint8_t*, size_t);
+
+};
@@ -0,0 +1,112 @@
+#include "snapshot.h"
+
+#include <iterator>
+
+Snapshot::Snapshot(){
+
+	snapshot_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header.version = SNAPSHOT_VERSION;
+
+	bytes.assign((uint8_t*)&header, (uint8_t*)&header + sizeof(header));
+
+	read_pos = sizeof(header);
+	ok = true;
+
+}
+
+Snapshot::Snapshot(const uint8_t *data, size_t size){
+
+	bytes.assign(data, data + size);
+	check_header();
+
+}
+
+void Snapshot::put(const void *data, size_t size){
+
+	bytes.insert(bytes.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+
+}
+
+//Past the end it reads zeros and the snapshot is no longer valid
+void Snapshot::get(void *data, size_t size){
+
+	if(!ok or read_pos + size > bytes.size()){
+		memset(data, 0, size);
+		ok = false;
+		return;
+	}
+
+	memcpy(data, &bytes[read_pos], size);
+	read_pos += size;
+
+}
+
+bool Snapshot::valid(){
+
+	return ok;
+
+}
+
+void Snapshot::check_header(){
+
+	read_pos = sizeof(snapshot_header);
+	ok = false;
+
+	if(bytes.size() < sizeof(snapshot_header))
+		return;
+
+	snapshot_header header;
+	memcpy(&header, bytes.data(), sizeof(header));
+
+	ok = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0
+		and header.version == SNAPSHOT_VERSION
+		and header.size == bytes.size() - sizeof(header);
+
+}
+
+bool Snapshot::save(const string &filename){
+
+	ofstream file(filename, ios::binary);
+
+	if(!file.is_open())
+		return false;
+
+	file.write((const char*)data(), size());
+
+	return file.good();
+
+}
+
+bool Snapshot::load(const string &filename){
+
+	ifstream file(filename, ios::binary);
+
+	if(!file.is_open()){
+		ok = false;
+		return false;
+	}
+
+	bytes.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	check_header();
+
+	return ok;
+
+}
+
+//Header updated with the size written so far
+const uint8_t* Snapshot::data(){
+
+	snapshot_header *header = (snapshot_header*)bytes.data();
+	header->size = bytes.size() - sizeof(snapshot_header);
+
+	return bytes.data();
+
+}
+
+size_t Snapshot::size(){
+
+	return bytes.size();
+
+}
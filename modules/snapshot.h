@@ -0,0 +1,57 @@
+#pragma once
+
+class Snapshot;
+
+#include "library.h"
+
+#include <vector>
+
+#define SNAPSHOT_MAGIC "C64SNAP"
+#define SNAPSHOT_VERSION 1
+
+//Values are stored in host byte order
+struct snapshot_header{
+	char magic[8];
+	uint32_t version;
+	uint32_t size;
+};
+
+//State of a whole machine as a flat byte stream, each component puts and gets
+//its own part, always in the same order
+class Snapshot{
+
+	public:
+		//Empty, to be written
+		Snapshot();
+
+		//To be read, the data is copied
+		Snapshot(const uint8_t*, size_t);
+
+		template<typename T> void put(const T &value){ put(&value, sizeof(T)); }
+		template<typename T> void get(T &value){ get(&value, sizeof(T)); }
+
+		void put(const void*, size_t);
+		void get(void*, size_t);
+
+		//False if the header is not ours or something was read past the end
+		bool valid();
+
+		bool save(const string&);
+		bool load(const string&);
+
+		const uint8_t* data();
+		size_t size();
+
+	private:
+		vector<uint8_t> bytes;
+		size_t read_pos;
+		bool ok;
+
+		void check_header();
+
+};
+
+//Taken at BASIC_READY after a cold boot, generated at build time by make_snapshot
+//and linked only into main
+extern const uint8_t ready_snapshot[];
+extern const size_t ready_snapshot_size;
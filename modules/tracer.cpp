@@ -0,0 +1,72 @@
+#include "tracer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+Tracer::Tracer(uint32_t capacity){
+
+	uint64_t size = 1;
+
+	while(size < capacity)
+		size <<= 1;
+
+	records = new trace_record[size];
+	mask = size - 1;
+	next = 0;
+
+}
+
+Tracer::~Tracer(){
+
+	delete[] records;
+
+}
+
+static bool write_all(int fd, const void *data, size_t size){
+
+	const char *p = (const char*)data;
+
+	while(size > 0){
+
+		ssize_t written = write(fd, p, size);
+
+		if(written <= 0)
+			return false;
+
+		p += written;
+		size -= written;
+	}
+
+	return true;
+
+}
+
+bool Tracer::dump(const char *filename){
+
+	int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if(fd < 0)
+		return false;
+
+	uint64_t size = mask + 1;
+	uint64_t count = (next < size) ? next : size;
+	uint64_t first = (next - count) & mask;
+
+	trace_header header;
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(trace_record);
+	header.records = count;
+
+	//The oldest records sit right after the newest one once the buffer wrapped
+	uint64_t tail = min(count, size - first);
+
+	bool ok = write_all(fd, &header, sizeof(header))
+		and write_all(fd, records + first, tail * sizeof(trace_record))
+		and write_all(fd, records, (count - tail) * sizeof(trace_record));
+
+	close(fd);
+
+	return ok;
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+class Tracer;
+
+#include "library.h"
+
+#define TRACE_FILE "trace.bin"
+#define TRACE_MAGIC "C64TRACE"
+#define TRACE_VERSION 1
+
+//Last 4M instructions, 64 MB
+#define TRACE_RECORDS (1 << 22)
+
+//One executed instruction, registers as they were before it ran
+struct trace_record{
+	uint64_t cycle;
+	uint16_t PC;
+	uint8_t opcode;
+	uint8_t A;
+	uint8_t X;
+	uint8_t Y;
+	uint8_t SP;
+	uint8_t P;
+};
+
+static_assert(sizeof(trace_record) == 16, "trace_record is written as is to the trace file");
+
+struct trace_header{
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t records;
+};
+
+//Ring buffer of the last executed instructions, dumped oldest first
+class Tracer{
+
+	public:
+		//Capacity is rounded up to a power of two
+		Tracer(uint32_t = TRACE_RECORDS);
+		~Tracer();
+
+		void record(uint64_t cycle, uint16_t pc, uint8_t opcode, const uint8_t *reg, uint8_t sp, uint8_t p){
+
+			trace_record &r = records[next++ & mask];
+
+			r.cycle = cycle;
+			r.PC = pc;
+			r.opcode = opcode;
+			r.A = reg[regA];
+			r.X = reg[regX];
+			r.Y = reg[regY];
+			r.SP = sp;
+			r.P = p;
+		}
+
+		//Only open/write/close, so it can run from a signal handler
+		bool dump(const char*);
+
+	private:
+		trace_record *records;
+		uint64_t mask;
+		uint64_t next;
+
+};
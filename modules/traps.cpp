@@ -0,0 +1,222 @@
+#include "traps.h"
+
+struct trap_name{
+	const char *name;
+	uint16_t addr;
+};
+
+static const trap_name trap_names[] = {
+	{"CHROUT", CHROUT_addr},
+	{"LOAD", LOAD_addr},
+	{"FADD", FADD_addr},
+	{"FADD", FADDT_addr},
+	{"FSUB", FSUB_addr},
+	{"FSUB", FSUBT_addr},
+	{"FMULT", FMULT_addr},
+	{"FMULT", FMULTT_addr},
+	{"FDIV", FDIV_addr},
+	{"FDIV", FDIVT_addr},
+};
+
+Traps::Traps(CPU *cpu, Memory *memory) : basic_float(cpu, memory){
+
+	this->cpu = cpu;
+	this->memory = memory;
+
+	memset(enabled,0,sizeof(enabled));
+
+}
+
+bool Traps::enable(const string &name){
+
+	bool found = false;
+
+	//The float routines have a second entry point with ARG already unpacked
+	for(const trap_name &trap : trap_names){
+
+		if(name != trap.name)
+			continue;
+
+		SET_I_BIT(enabled[trap.addr >> 3], (trap.addr & 7));
+		found = true;
+	}
+
+	return found;
+
+}
+
+void Traps::setLoadDirectory(const string &directory){
+
+	load_directory = directory;
+
+}
+
+bool Traps::run_trap(uint16_t pc){
+
+	bool done = false;
+
+	switch(pc){
+		case CHROUT_addr:	done = chrout(); break;
+		case LOAD_addr:		done = load(); break;
+		case FADD_addr:		done = basic_float.fadd(true); break;
+		case FADDT_addr:	done = basic_float.fadd(false); break;
+		case FSUB_addr:		done = basic_float.fsub(true); break;
+		case FSUBT_addr:	done = basic_float.fsub(false); break;
+		case FMULT_addr:	done = basic_float.fmult(true); break;
+		case FMULTT_addr:	done = basic_float.fmult(false); break;
+		case FDIV_addr:		done = basic_float.fdiv(true); break;
+		case FDIVT_addr:	done = basic_float.fdiv(false); break;
+	}
+
+	if(done)
+		rts();
+
+	return done;
+
+}
+
+//Back to the caller of the jump table entry
+void Traps::rts(){
+
+	cpu->RTS();
+
+}
+
+//Printable characters on the screen, as $E716 does when the cursor stays on the same line
+bool Traps::chrout(){
+
+	uint8_t c = cpu->regs.reg[regA];
+
+	if(memory->read_word(IBSOUT_vector) != CHROUT_routine or memory->read_zero_page(OUTPUT_DEVICE_addr) != SCREEN_DEVICE)
+		return false;
+
+	//Control codes, shifted characters, quotes and insert mode take other paths in the ROM
+	if(c < 0x20 or c >= 0x80 or c == '"' or memory->read_zero_page(INSERT_COUNT_addr) != 0)
+		return false;
+
+	uint8_t col = memory->read_zero_page(CURSOR_COL_addr);
+
+	//Going past the end of the line links lines and may scroll
+	if(col >= memory->read_zero_page(LINE_LENGTH_addr))
+		return false;
+
+	//PETSCII to screen code
+	uint8_t code = (c < 0x60) ? (c & 0x3F) : (c & 0xDF);
+
+	if(memory->read_zero_page(REVERSE_addr) != 0)
+		code |= 0x80;
+
+	uint16_t line = memory->read_zero_page_word(SCREEN_LINE_addr);
+	uint16_t color_line = (line & 0x03FF) | COLOR_RAM_START;
+
+	memory->write_zero_page(LAST_CHAR_addr, c);
+	memory->write_zero_page(INPUT_DEVICE_EOL_addr, 0);
+	memory->write_zero_page(BLINK_COUNT_addr, 2);
+	memory->write_zero_page(COLOR_LINE_addr, color_line & 0xFF);
+	memory->write_zero_page(COLOR_LINE_addr + 1, color_line >> 8);
+
+	memory->write_byte(line + col, code);
+	memory->write_byte(color_line + col, memory->read_byte(CURSOR_COLOR_addr));
+
+	//Into the second physical line of a logical one
+	uint8_t row = memory->read_zero_page(CURSOR_ROW_addr);
+
+	if((col == 39 or col == 79) and row != 25)
+		memory->write_zero_page(CURSOR_ROW_addr, row + 1);
+
+	memory->write_zero_page(CURSOR_COL_addr, col + 1);
+
+	//A, X and Y are preserved, the ROM returns with CLC and CLI
+	cpu->regs.carry_flag = false;
+	cpu->regs.nz_result = c;
+	cpu->set_interrupt_flag(false);
+
+	return true;
+
+}
+
+//The guest picks the name, so nothing that could leave the load directory: no separators,
+//no "..", no hidden files and no control characters
+bool Traps::safe_name(const string &name){
+
+	if(name.empty() or name[0] == '.' or name.find("..") != string::npos)
+		return false;
+
+	for(char c : name)
+		if(c == '/' or c == '\\' or (uint8_t)c < 0x20 or (uint8_t)c > 0x7E)
+			return false;
+
+	return true;
+
+}
+
+//LOAD from device 8 reading the file from the load directory
+bool Traps::load(){
+
+	uint8_t verify = cpu->regs.reg[regA];
+	uint8_t length = memory->read_zero_page(FILENAME_LEN_addr);
+
+	if(memory->read_word(ILOAD_vector) != LOAD_routine or memory->read_zero_page(DEVICE_addr) != DISK_DEVICE)
+		return false;
+
+	if(verify != 0 or length == 0)
+		return false;
+
+	uint16_t name_addr = memory->read_zero_page_word(FILENAME_PTR_addr);
+	string name = "";
+
+	for(uint8_t i = 0; i < length; i++){
+
+		char c = memory->read_byte(name_addr + i);
+
+		//Directory and pattern matching are left to the ROM
+		if(c == '*' or c == '?' or c == '$')
+			return false;
+
+		name += (c >= 'A' and c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+
+	uint8_t x = cpu->regs.reg[regX];
+	uint8_t y = cpu->regs.reg[regY];
+
+	memory->write_zero_page(LOAD_START_addr, x);
+	memory->write_zero_page(LOAD_START_addr + 1, y);
+	memory->write_zero_page(VERIFY_FLAG_addr, verify);
+	memory->write_zero_page(STATUS_addr, 0);
+
+	MappedFile file;
+
+	if(safe_name(name) and !file.open(load_directory + "/" + name))
+		file.open(load_directory + "/" + name + ".prg");
+
+	const uint8_t *data = file.data();
+
+	if(file.size() < 2){
+		cpu->regs.reg[regA] = FILE_NOT_FOUND;
+		cpu->regs.carry_flag = true;
+		return true;
+	}
+
+	//Secondary address 0 loads at X/Y, otherwise where the file says
+	uint16_t addr = data[0] | (data[1] << 8);
+
+	if(memory->read_zero_page(SECONDARY_ADDR_addr) == 0)
+		addr = x | (y << 8);
+
+	uint32_t end = addr;
+
+	for(size_t i = 2; i < file.size() and end <= 0xFFFF; i++)
+		memory->write_byte(end++, data[i]);
+
+	memory->write_zero_page(LOAD_END_addr, end & 0xFF);
+	memory->write_zero_page(LOAD_END_addr + 1, (end >> 8) & 0xFF);
+	memory->write_zero_page(STATUS_addr, STATUS_EOF);
+
+	cpu->regs.reg[regX] = end & 0xFF;
+	cpu->regs.reg[regY] = (end >> 8) & 0xFF;
+	cpu->regs.nz_result = cpu->regs.reg[regY];
+	cpu->regs.carry_flag = false;
+
+	return true;
+
+}
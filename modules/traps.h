@@ -0,0 +1,91 @@
+#pragma once
+
+class Traps;
+
+#include "library.h"
+#include "cpu.h"
+#include "memory.h"
+#include "basic_float.h"
+
+//KERNAL jump table entries
+#define CHROUT_addr 0xFFD2
+#define LOAD_addr 0xFFD5
+
+//KERNAL vectors and the routines they point to after reset
+#define IBSOUT_vector 0x0326
+#define ILOAD_vector 0x0330
+#define CHROUT_routine 0xF1CA
+#define LOAD_routine 0xF4A5
+
+//KERNAL variables
+#define STATUS_addr 0x90
+#define VERIFY_FLAG_addr 0x93
+#define LOAD_END_addr 0xAE
+#define FILENAME_LEN_addr 0xB7
+#define SECONDARY_ADDR_addr 0xB9
+#define DEVICE_addr 0xBA
+#define FILENAME_PTR_addr 0xBB
+#define LOAD_START_addr 0xC3
+#define REVERSE_addr 0xC7
+#define BLINK_COUNT_addr 0xCD
+#define SCREEN_LINE_addr 0xD1
+#define CURSOR_COL_addr 0xD3
+#define QUOTE_MODE_addr 0xD4
+#define LINE_LENGTH_addr 0xD5
+#define CURSOR_ROW_addr 0xD6
+#define LAST_CHAR_addr 0xD7
+#define INSERT_COUNT_addr 0xD8
+#define COLOR_LINE_addr 0xF3
+#define CURSOR_COLOR_addr 0x0286
+#define INPUT_DEVICE_EOL_addr 0xD0
+#define OUTPUT_DEVICE_addr 0x9A
+
+#define SCREEN_DEVICE 3
+#define DISK_DEVICE 8
+
+#define STATUS_EOF 0x40
+#define FILE_NOT_FOUND 4
+
+#define DEFAULT_LOAD_DIR "."
+
+//Native versions of KERNAL and BASIC routines, run in place of the ROM code when PC reaches them.
+//A handler either does the whole job and returns true, or leaves it to the ROM
+class Traps{
+
+	public:
+		Traps(CPU*,Memory*);
+
+		//By name, "CHROUT", "LOAD", "FADD", "FSUB", "FMULT" or "FDIV", false if there is no such trap
+		bool enable(const string&);
+
+		//The only host directory LOAD reads from. Guest names are plain file names in it, never paths
+		void setLoadDirectory(const string&);
+
+		//Only called while a ROM is mapped at pc, returns true if the routine has been run
+		//and PC is back to the caller
+		bool run(uint16_t pc){
+			if(!GET_I_BIT(enabled[pc >> 3], pc & 7))
+				return false;
+
+			return run_trap(pc);
+		}
+
+	private:
+		CPU *cpu;
+		Memory *memory;
+		BasicFloat basic_float;
+
+		uint8_t enabled[0x10000 / 8];
+
+		string load_directory = DEFAULT_LOAD_DIR;
+
+		bool run_trap(uint16_t);
+
+		bool chrout();
+		bool load();
+
+		static bool safe_name(const string&);
+
+		void rts();
+
+};
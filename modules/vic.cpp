@@ -1,5 +1,7 @@
 #include "vic.h"
 
+#include <SDL2/SDL.h>
+
 VIC::VIC(){
 
 	registers = new uint8_t[0x400];    
@@ -29,16 +31,17 @@ VIC::VIC(){
 
 	memset(&color_palette[0],0,16*sizeof(host_pixel_t));
 
+	redraw_all();
+
 }
 
 VIC::~VIC(){
 
 	delete[] registers;
+	delete[] own_video_memory;
 }
 
-void VIC::init_color_palette(){
-
-    SDL_PixelFormat *format = sdl->getPixelFormat();
+void VIC::init_color_palette(SDL_PixelFormat *format){
 
 	color_palette[0] 	= SDL_MapRGB(format, 0x00, 0x00, 0x00);		//black
 	color_palette[1] 	= SDL_MapRGB(format, 0xFF, 0xFF, 0xFF);		//white
@@ -135,19 +138,18 @@ void VIC::show_char_line(uint8_t offset, int X, int Y, int line_offset){
 
 	host_pixel_t *ptr = host_video_memory + SCREEN_WIDTH * (line_offset + X) + Y;
 
+	//Glyph row, the same for all its pixels
+	uint8_t row_value = memory->VIC_read_byte(char_memory_base_addr + CHAR_WIDTH * offset + line_offset);
+
 	for(int j=0; j < CHAR_WIDTH; j++){
 
 		if(graphic_mode == CHAR_MODE or (fg_color_idx < 8)){
 
-			uint8_t row_value = memory->VIC_read_byte(char_memory_base_addr + CHAR_WIDTH * offset + line_offset);
-
 			uint8_t pixel_value = GET_I_BIT(row_value, 7-j);
 			ptr[j] = (pixel_value) ? fg_color : bg_color;
 
 		} else if(fg_color_idx >= 8 and graphic_mode == MCM_TEXT_MODE){			//MCM
 
-			uint8_t row_value = memory->VIC_read_byte(char_memory_base_addr + CHAR_WIDTH * offset + line_offset);
-			
 			//FE mask is to get only even numbers
 			uint8_t value = GET_TWO_BITS(row_value,(7-j) & 0xFE);
 
@@ -168,16 +170,98 @@ void VIC::show_char_line(uint8_t offset, int X, int Y, int line_offset){
 }
 
 
-void VIC::clock(){
+void VIC::clock(uint32_t cycles){
+
+	while(cycles >= clocks_to_new_line){
+
+		cycles -= clocks_to_new_line;
+		check_raster_irq();
+		new_line();
+	}
+
+	clocks_to_new_line -= cycles;
+	check_raster_irq();
+
+}
+
+uint32_t VIC::cycles_to_next_line(){
+
+	return clocks_to_new_line;
+
+}
+
+chrono::steady_clock::time_point VIC::frame_deadline(){
+
+	//Nothing is ever waited for in warp
+	if(warp)
+		return last_time_rendered;
+
+	return last_time_rendered + chrono::milliseconds(FRAME_MS);
+
+}
+
+void VIC::end_frame(){
+
+	if(draw_frame and sdl)
+		sdl->render_frame(changed_lines);
+
+	//Writes are kept until a frame is drawn with them
+	if(draw_frame){
+		memset(&frame_writes,0,sizeof(frame_writes));
+		memset(changed_lines,0,sizeof(changed_lines));
+	}
+
+	memory->takeVideoWrites(frame_writes);
+
+	if(sdl and sdl->warpRequested())
+		setWarp(!warp);
+
+	auto now = chrono::steady_clock::now();
+
+	if(warp){
+		frames_skipped = draw_frame ? 0 : frames_skipped + 1;
+		draw_frame = (frames_skipped + 1 >= WARP_FRAME_SKIP);
+
+		last_time_rendered = now;
+		return;
+	}
+
+	//Frames are due every FRAME_MS from the first one, sleeping late does not add up
+	last_time_rendered += chrono::milliseconds(FRAME_MS);
+
+	if(now - last_time_rendered < chrono::milliseconds(FRAME_MS)){
+
+		this_thread::sleep_until(last_time_rendered);
+
+		draw_frame = true;
+		frames_skipped = 0;
+
+	} else if(frames_skipped < MAX_FRAME_SKIP){
+
+		//A whole frame behind, the next one is only emulated
+		draw_frame = false;
+		frames_skipped++;
+
+	} else {
+
+		//Too far behind to catch up, real time starts over from here
+		last_time_rendered = now;
+
+		draw_frame = true;
+		frames_skipped = 0;
+	}
+
+}
+
+void VIC::check_raster_irq(){
 
 	if(interrupt_enabled and rasterline == registers[RASTER_LINE - IO_START]){
 		cpu->setIRQline();
 	}
 
-	clocks_to_new_line--;
+}
 
-	if(clocks_to_new_line != 0)
-		return;
+void VIC::new_line(){
 
 	rasterline++;
 
@@ -188,32 +272,39 @@ void VIC::clock(){
 		rasterline = 0;
 
 	if(rasterline == 0){
-
-		sdl->render_frame();
-
-		auto current_time = chrono::steady_clock::now();
-
-		auto c = current_time - last_time_rendered;
-
-		c = chrono::milliseconds(20) - c;
-
-		this_thread::sleep_for(c);
-
-		last_time_rendered = chrono::steady_clock::now();
+		end_frame();
 		return;
 	}
 
+	//Frame skipped, or headless and nobody asked for it yet, see getVideoMemoryPtr
+	if(!draw_frame or host_video_memory == nullptr)
+		return;
+
 	//< not <= because are 200 not 201!
 	if(!(rasterline >= FIRST_SCREEN_LINE and rasterline < LAST_SCREEN_LINE))
 		return;
 	
 	//50 is the first visible rasterline;
-	uint16_t crt_row = rasterline - FIRST_SCREEN_LINE;
+	draw_line(rasterline - FIRST_SCREEN_LINE);
+
+}
+
+void VIC::draw_line(uint16_t crt_row){
+
 	//Offset inside a character, eg: 2° pixel row of a letter ( each char is 8x8 pixels )
 	uint8_t row_offset = crt_row % 8;
 
 	uint32_t cursorX = crt_row/8;
 
+	//Same registers and nothing written since it was drawn, the line on the host is still good
+	uint64_t state = line_state();
+
+	if(state == drawn_state[crt_row] and !line_written(cursorX))
+		return;
+
+	drawn_state[crt_row] = state;
+	changed_lines[crt_row] = true;
+
 	for(int i=0;i < 40; i++){
 		
 		uint32_t cursorY = i * 8;
@@ -238,6 +329,65 @@ void VIC::clock(){
 
 }
 
+uint64_t VIC::line_state(){
+
+	uint64_t bank = cia2 ? cia2->getVICBank() : 0;
+
+	return graphic_mode | (registers[BASE_ADDR_REG - REG_START] << 8)
+		| (registers[0xD021 - REG_START] << 16) | ((uint64_t)registers[0xD022 - REG_START] << 24)
+		| ((uint64_t)registers[0xD023 - REG_START] << 32) | (bank << 40);
+
+}
+
+//Anything a line of the given text row reads from, see show_char_line and the bitmap ones
+bool VIC::line_written(uint16_t row){
+
+	uint64_t color_blocks = (1ULL << ((row * 40 + 39) >> VIDEO_BLOCK_SHIFT) << 1) - (1ULL << ((row * 40) >> VIDEO_BLOCK_SHIFT));
+
+	if((frame_writes.color | memory->videoWrites().color) & color_blocks)
+		return true;
+
+	if(written(screen_memory_base_addr + row * 40, 40))
+		return true;
+
+	if(graphic_mode == CHAR_MODE or graphic_mode == MCM_TEXT_MODE)
+		return written(char_memory_base_addr, 0x800);
+
+	//Both bitmap modes read no further than 600 bytes from the start of the row
+	return written(bitmap_memory_base_addr + row * 320, 600);
+
+}
+
+//addr as seen by the VIC, wrapping inside its bank like VIC_read_byte
+bool VIC::written(uint16_t addr, uint16_t size){
+
+	const video_writes &live = memory->videoWrites();
+
+	uint32_t bank_block = (0x4000 >> VIDEO_BLOCK_SHIFT) * (cia2 ? cia2->getVICBank() : 0);
+	uint32_t bank_blocks = 0x4000 >> VIDEO_BLOCK_SHIFT;
+
+	for(uint32_t block = addr >> VIDEO_BLOCK_SHIFT; block <= (uint32_t)(addr + size - 1) >> VIDEO_BLOCK_SHIFT; block++){
+
+		uint32_t absolute = bank_block + block % bank_blocks;
+		uint64_t bit = 1ULL << (absolute & 63);
+
+		if((frame_writes.ram[absolute >> 6] | live.ram[absolute >> 6]) & bit)
+			return true;
+	}
+
+	return false;
+
+}
+
+//Next frame draws every line and uploads it whole
+void VIC::redraw_all(){
+
+	memset(drawn_state,0xFF,sizeof(drawn_state));
+	memset(&frame_writes,0,sizeof(frame_writes));
+	memset(changed_lines,0,sizeof(changed_lines));
+
+}
+
 void VIC::setMemory(Memory *mem){
 	this->memory = mem;
 	this->guest_color_memory = mem->getColorMemoryPtr();
@@ -250,7 +400,42 @@ void VIC::setSDL(SDLManager *sdl){
 
 	memset(host_video_memory,0xE0,64000);
 
-	init_color_palette();
+	init_color_palette(sdl->getPixelFormat());
+
+	redraw_all();
+
+}
+
+//No window, frames are drawn in a buffer of our own. It is allocated by the first
+//getVideoMemoryPtr, until then nothing is drawn
+void VIC::setHeadless(){
+
+	sdl = nullptr;
+	host_video_memory = own_video_memory;
+
+}
+
+host_pixel_t* VIC::getVideoMemoryPtr(){
+
+	if(host_video_memory)
+		return host_video_memory;
+
+	own_video_memory = new host_pixel_t[SCREEN_WIDTH * SCREEN_HEIGHT];
+	host_video_memory = own_video_memory;
+
+	memset(host_video_memory,0xE0,SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(host_pixel_t));
+
+	SDL_PixelFormat *format = SDL_AllocFormat(PIXEL_FORMAT);
+	init_color_palette(format);
+	SDL_FreeFormat(format);
+
+	//The whole frame as it is now, later frames redraw what changes
+	redraw_all();
+
+	for(uint16_t row = 0; row < SCREEN_LINES; row++)
+		draw_line(row);
+
+	return host_video_memory;
 
 }
 
@@ -260,12 +445,76 @@ void VIC::setCIA1(CIA1 *cia1){
 
 }
 
+//Whatever save puts, the graphic mode as one byte
+const size_t VIC::snapshot_size = 0x400 + sizeof(uint8_t) + sizeof(visible_rows) + sizeof(visible_cols)
+	+ sizeof(rasterline) + sizeof(screen_memory_base_addr) + sizeof(char_memory_base_addr)
+	+ sizeof(bitmap_memory_base_addr) + sizeof(interrupt_enabled) + sizeof(clocks_to_new_line);
+
+void VIC::save(Snapshot &snapshot){
+
+	uint8_t mode = graphic_mode;
+
+	snapshot.put(registers, 0x400);
+	snapshot.put(mode);
+	snapshot.put(visible_rows);
+	snapshot.put(visible_cols);
+	snapshot.put(rasterline);
+	snapshot.put(screen_memory_base_addr);
+	snapshot.put(char_memory_base_addr);
+	snapshot.put(bitmap_memory_base_addr);
+	snapshot.put(interrupt_enabled);
+	snapshot.put(clocks_to_new_line);
+
+}
+
+void VIC::restore(Snapshot &snapshot){
+
+	uint8_t mode;
+
+	snapshot.get(registers, 0x400);
+	snapshot.get(mode);
+	snapshot.get(visible_rows);
+	snapshot.get(visible_cols);
+	snapshot.get(rasterline);
+	snapshot.get(screen_memory_base_addr);
+	snapshot.get(char_memory_base_addr);
+	snapshot.get(bitmap_memory_base_addr);
+	snapshot.get(interrupt_enabled);
+	snapshot.get(clocks_to_new_line);
+
+	graphic_mode = (MODES)mode;
+
+	//The frame being drawn is due a frame from now
+	last_time_rendered = chrono::steady_clock::now();
+
+	redraw_all();
+
+}
+
 void VIC::setCIA2(CIA2 *cia2){
 
 	this->cia2 = cia2;
 
 }
 
+void VIC::setWarp(bool warp){
+
+	this->warp = warp;
+
+	//Back at normal speed frames are due from now on
+	last_time_rendered = chrono::steady_clock::now();
+
+	draw_frame = true;
+	frames_skipped = 0;
+
+}
+
+bool VIC::isWarp(){
+
+	return warp;
+
+}
+
 //TODO: 
 uint8_t VIC::read_register(uint16_t addr){
     
@@ -314,8 +563,8 @@ void VIC::write_register(uint16_t addr, uint8_t data){
 			break;
 
 		case RASTER_LINE:
-			cout<<"writing to raster cnt"<<endl;
-			cout<<hex<<unsigned(data)<<endl;
+			DEBUG_PRINT("writing to raster cnt"<<endl);
+			DEBUG_PRINT(hex<<unsigned(data)<<endl);
 
 
 
@@ -363,21 +612,22 @@ void VIC::set_graphic_mode(){
 	bool mcm = GET_I_BIT(registers[CTRL_REG_2_OFF],4); 
 
 	if(!ecm && !bmm && !mcm){
-		cout<<"CHAR"<<endl;
+		DEBUG_PRINT("CHAR"<<endl);
 
 		graphic_mode = CHAR_MODE;
 	}else if(!ecm && !bmm && mcm){
-		cout<<"MCM CHAR"<<endl;
+		DEBUG_PRINT("MCM CHAR"<<endl);
 
 		graphic_mode = MCM_TEXT_MODE;
 	} else if(!ecm && bmm && !mcm){
-		cout<<"BITMAP"<<endl;
+		DEBUG_PRINT("BITMAP"<<endl);
 		graphic_mode = BITMAP_MODE;
 	} else if(!ecm && bmm && mcm){
-		cout<<"MCM BITMAP"<<endl;
+		DEBUG_PRINT("MCM BITMAP"<<endl);
 		graphic_mode = MCB_BITMAP_MODE;
-	} else
-		cout<<"UNIMPL MODE"<<endl;
+	} else {
+		DEBUG_PRINT("UNIMPL MODE"<<endl);
+	}
 
 	//Unimplemented
 	/*else if(ecm && !bmm && !mcm)
@@ -9,6 +9,9 @@ class VIC;
 #include "cpu.h"
 #include "cia1.h"
 #include "cia2.h"
+#include "snapshot.h"
+
+struct SDL_PixelFormat;
 
 #define REG_START 0xD000
 #define REG_END 0xD02E
@@ -30,11 +33,20 @@ class VIC;
 
 #define FIRST_SCREEN_LINE 50
 #define LAST_SCREEN_LINE 250
+#define SCREEN_LINES (LAST_SCREEN_LINE - FIRST_SCREEN_LINE)
 
 #define CTRL_REG_1_OFF CTRL_REG_1 - REG_START
 #define CTRL_REG_2_OFF CTRL_REG_2 - REG_START
 
 #define CLOCK_NUMBER 20000					//50Hz and clock is 1 MHz
+#define FRAME_MS 20
+#define FRAME_CYCLES (RASTER_LINE_CLKS * LAST_RASTER_LINE)
+
+//In warp one frame out of WARP_FRAME_SKIP is drawn
+#define WARP_FRAME_SKIP 10
+
+//At normal speed, frames left undrawn in a row while the host catches up with real time
+#define MAX_FRAME_SKIP 4
 
 enum MODES {CHAR_MODE,MCM_TEXT_MODE,EXT_BACK_MODE,BITMAP_MODE,MCB_BITMAP_MODE};
 
@@ -57,7 +69,18 @@ class VIC {
 
 		void set_graphic_mode();
 
-		void init_color_palette();
+		void check_raster_irq();
+		void new_line();
+		void end_frame();
+		void draw_line(uint16_t);
+
+		//Registers a screen line is drawn with, it is redrawn when they or its memory change
+		uint64_t line_state();
+		bool line_written(uint16_t);
+		bool written(uint16_t, uint16_t);
+		void redraw_all();
+
+		void init_color_palette(SDL_PixelFormat*);
 
 		void show_char_line(uint8_t, int, int,int);
 		void draw_bitmap_line(uint8_t, int, int, int);
@@ -76,28 +99,60 @@ class VIC {
 		//SDL
 
 		host_pixel_t *host_video_memory = nullptr;
+		host_pixel_t *own_video_memory = nullptr;
 
 		uint8_t *guest_color_memory = nullptr;
 
 		uint32_t clocks_to_new_line;
 
+		//When the frame being drawn started on the host
 		chrono::time_point<chrono::steady_clock> last_time_rendered;
 
+		bool warp = false;
+
+		//The frame being drawn goes to the screen, skipped ones are only emulated
+		bool draw_frame = true;
+		uint32_t frames_skipped = 0;
+
+		//Memory written since the last frame drawn was over, line_state() of each line as drawn
+		video_writes frame_writes;
+		uint64_t drawn_state[SCREEN_LINES];
+
+		//Lines drawn since the last render_frame
+		bool changed_lines[SCREEN_LINES];
+
 	public:
 		VIC();
 		~VIC();
 		
-		void clock();
+		void clock(uint32_t);
+		uint32_t cycles_to_next_line();
+
+		//When the frame being drawn is due on the host
+		chrono::steady_clock::time_point frame_deadline();
 
 		void setMemory(Memory*);
 		void setSDL(SDLManager*);
+		void setHeadless();
 		void setCPU(CPU*);
 		void setCIA1(CIA1*);
 		void setCIA2(CIA2*);
 
+		//No sleep between frames and one in WARP_FRAME_SKIP drawn,
+		//raster and timer irqs keep their timing in emulated cycles
+		void setWarp(bool);
+		bool isWarp();
 
 		uint8_t read_register(uint16_t);
 		void write_register(uint16_t,uint8_t);
 
+		//Registers and raster position
+		void save(Snapshot&);
+		void restore(Snapshot&);
+		static const size_t snapshot_size;
+
+		//Frame being drawn, SCREEN_WIDTH x SCREEN_HEIGHT pixels. Headless, the first call
+		//allocates it and draws the whole frame
+		host_pixel_t* getVideoMemoryPtr();
 
 };
@@ -0,0 +1,56 @@
+#include "modules/library.h"
+
+#include "modules/opcodes.h"
+#include "modules/tracer.h"
+
+#include <cstdio>
+
+//Prints a trace written by ./main --trace, one instruction per line, oldest first
+int main(int argc, const char **argv){
+
+	const char *filename = (argc > 1) ? argv[1] : TRACE_FILE;
+
+	FILE *file = fopen(filename, "rb");
+
+	if(file == nullptr){
+		cout<<"Cannot open "<<filename<<endl;
+		return 2;
+	}
+
+	trace_header header;
+
+	if(fread(&header, sizeof(header), 1, file) != 1 or memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+		or header.version != TRACE_VERSION or header.record_size != sizeof(trace_record)){
+		cout<<filename<<" is not a trace file"<<endl;
+		fclose(file);
+		return 1;
+	}
+
+	printf("%14s  %-4s  %-2s  %-3s  %-2s %-2s %-2s %-2s  %s\n", "cycle", "PC", "op", "", "A", "X", "Y", "SP", "NV-BDIZC");
+
+	trace_record r;
+	uint64_t decoded = 0;
+
+	while(decoded < header.records and fread(&r, sizeof(r), 1, file) == 1){
+
+		char flags[9];
+		for(int i = 0; i < 8; i++)
+			flags[i] = GET_I_BIT(r.P, 7 - i) ? "NV-BDIZC"[i] : '.';
+		flags[8] = '\0';
+
+		printf("%14llu  %04x  %02x  %-3s  %02x %02x %02x %02x  %s\n", (unsigned long long)r.cycle, r.PC, r.opcode,
+			opcode_table[r.opcode].mnemonic, r.A, r.X, r.Y, r.SP, flags);
+
+		decoded++;
+	}
+
+	fclose(file);
+
+	if(decoded != header.records){
+		cout<<"Trace truncated after "<<decoded<<" of "<<header.records<<" records"<<endl;
+		return 1;
+	}
+
+	return 0;
+
+}